@@ -0,0 +1,2518 @@
+#ifndef BANKERS_H
+#define BANKERS_H
+
+#include <ostream>
+#include <vector>
+#include <array>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string_view>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <climits>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BANKERS_X86_SIMD 1
+#endif
+
+/*
+    Banker's Algorithm library, linked into project3 and usable on its own.
+
+    What this file provides:
+    - BankersAlgorithm (dense rows; FixedBankersAlgorithm and narrower element types through
+    BasicBankersAlgorithm) and SparseBankersAlgorithm (CSR rows): the sweep, worklist and parallel
+    safety algorithms, the resource-request steps with transactions, releases and finishes.
+    - InputScanner and parseState() for the textual input format, and binary snapshots.
+    - decideRequest(), which runs one request through the resource-request algorithm and returns a
+    RequestResult, and RequestIngest, which takes requests from other threads without locking.
+    Nothing here writes to the standard streams: printing goes to a caller's std::ostream, and the
+    cross-check engine's disagreements are kept for the caller to take and report.
+    - Everything is declared in namespace bankers, and standard names are written std::, so including
+    the header does not bring namespace std into scope.
+*/
+
+namespace bankers {
+
+// Dense rows x cols matrix stored row-major in a single contiguous buffer,
+// so walking a process's row (or the whole matrix) streams through memory.
+template <class T>
+class BasicMatrix {
+    private:
+        int numRows;            // Number of rows (processes)
+        int numCols;            // Number of columns (resources)
+        std::vector<T> data;    // Row-major storage, numRows * numCols elements
+    public:
+        BasicMatrix(int rows = 0, int cols = 0)
+            : numRows(rows), numCols(cols), data((size_t)rows * (size_t)cols, 0) {}
+
+        int rows() const { return numRows; }
+        int cols() const { return numCols; }
+        size_t size() const { return data.size(); }
+
+        // Pointer to the first element of row i
+        T* row(int i) { return data.data() + (size_t)i * (size_t)numCols; }
+        const T* row(int i) const { return data.data() + (size_t)i * (size_t)numCols; }
+
+        T& operator()(int i, int j) { return row(i)[j]; }
+        T operator()(int i, int j) const { return row(i)[j]; }
+
+        // Whole buffer, for loops that don't care about row boundaries
+        T* raw() { return data.data(); }
+        const T* raw() const { return data.data(); }
+
+        void setRow(int i, const std::vector<int>& values) {
+            std::copy(values.begin(), values.end(), row(i));
+        }
+};
+
+typedef BasicMatrix<int> Matrix;
+
+// Vector kernels for the per-resource loops of the Banker's algorithm.
+// The widest implementation the CPU supports (AVX-512, AVX2, else scalar) is picked once at
+// startup; rows shorter than one AVX2 register stay on the inline scalar path.
+namespace kernels {
+    typedef int (*FirstExceedingFn)(const int* a, const int* b, int n);
+    typedef void (*UpdateFn)(int* dst, const int* src, int n);
+
+    // Scalar fallback: index of the first j with a[j] > b[j], or n if a <= b everywhere
+    inline int firstExceedingScalar(const int* a, const int* b, int n) {
+        for (int j = 0; j < n; ++j) if (a[j] > b[j]) return j;
+        return n;
+    }
+
+    inline void addScalar(int* dst, const int* src, int n) {
+        for (int j = 0; j < n; ++j) dst[j] += src[j];
+    }
+
+    inline void subtractScalar(int* dst, const int* src, int n) {
+        for (int j = 0; j < n; ++j) dst[j] -= src[j];
+    }
+
+    // a + b for the narrow unsigned element types, clamped to the type's maximum
+    template <class T>
+    inline T saturatingAdd(T a, T b) {
+        T sum = (T)(a + b);
+        return sum < a ? std::numeric_limits<T>::max() : sum;
+    }
+
+#ifdef BANKERS_X86_SIMD
+    __attribute__((target("avx2")))
+    inline int firstExceedingAvx2(const int* a, const int* b, int n) {
+        int j = 0;
+        for (; j + 8 <= n; j += 8) {
+            __m256i gt = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i*)(a + j)),
+                                            _mm256_loadu_si256((const __m256i*)(b + j)));
+            int mask = _mm256_movemask_ps(_mm256_castsi256_ps(gt));
+            if (mask) return j + __builtin_ctz(mask);
+        }
+        for (; j < n; ++j) if (a[j] > b[j]) return j;
+        return n;
+    }
+
+    __attribute__((target("avx2")))
+    inline void addAvx2(int* dst, const int* src, int n) {
+        int j = 0;
+        for (; j + 8 <= n; j += 8) {
+            __m256i v = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(dst + j)),
+                                         _mm256_loadu_si256((const __m256i*)(src + j)));
+            _mm256_storeu_si256((__m256i*)(dst + j), v);
+        }
+        for (; j < n; ++j) dst[j] += src[j];
+    }
+
+    __attribute__((target("avx2")))
+    inline void subtractAvx2(int* dst, const int* src, int n) {
+        int j = 0;
+        for (; j + 8 <= n; j += 8) {
+            __m256i v = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(dst + j)),
+                                         _mm256_loadu_si256((const __m256i*)(src + j)));
+            _mm256_storeu_si256((__m256i*)(dst + j), v);
+        }
+        for (; j < n; ++j) dst[j] -= src[j];
+    }
+
+    // AVX-512 variants handle the tail with a masked load/store instead of a scalar loop
+    __attribute__((target("avx512f")))
+    inline int firstExceedingAvx512(const int* a, const int* b, int n) {
+        for (int j = 0; j < n; j += 16) {
+            __mmask16 live = (n - j >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (n - j)) - 1);
+            __mmask16 gt = _mm512_mask_cmpgt_epi32_mask(live, _mm512_maskz_loadu_epi32(live, a + j),
+                                                        _mm512_maskz_loadu_epi32(live, b + j));
+            if (gt) return j + __builtin_ctz(gt);
+        }
+        return n;
+    }
+
+    __attribute__((target("avx512f")))
+    inline void addAvx512(int* dst, const int* src, int n) {
+        for (int j = 0; j < n; j += 16) {
+            __mmask16 live = (n - j >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (n - j)) - 1);
+            __m512i v = _mm512_add_epi32(_mm512_maskz_loadu_epi32(live, dst + j),
+                                         _mm512_maskz_loadu_epi32(live, src + j));
+            _mm512_mask_storeu_epi32(dst + j, live, v);
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    inline void subtractAvx512(int* dst, const int* src, int n) {
+        for (int j = 0; j < n; j += 16) {
+            __mmask16 live = (n - j >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (n - j)) - 1);
+            __m512i v = _mm512_sub_epi32(_mm512_maskz_loadu_epi32(live, dst + j),
+                                         _mm512_maskz_loadu_epi32(live, src + j));
+            _mm512_mask_storeu_epi32(dst + j, live, v);
+        }
+    }
+
+    // Unsigned 8- and 16-bit lanes (32 or 16 per register): a > b exactly where max(a, b) != b.
+    // Adds saturate, so a Work sum that would not fit stays at the type's maximum instead of
+    // wrapping around to a small value that could pass for enough.
+    template <class T>
+    __attribute__((target("avx2")))
+    inline int firstExceedingAvx2Narrow(const T* a, const T* b, int n) {
+        const int lanes = 32 / sizeof(T);
+        int j = 0;
+        for (; j + lanes <= n; j += lanes) {
+            __m256i va = _mm256_loadu_si256((const __m256i*)(a + j));
+            __m256i vb = _mm256_loadu_si256((const __m256i*)(b + j));
+            __m256i fits = sizeof(T) == 1 ? _mm256_cmpeq_epi8(_mm256_max_epu8(va, vb), vb)
+                                          : _mm256_cmpeq_epi16(_mm256_max_epu16(va, vb), vb);
+            unsigned mask = ~(unsigned)_mm256_movemask_epi8(fits);
+            if (mask) return j + __builtin_ctz(mask) / (int)sizeof(T);
+        }
+        for (; j < n; ++j) if (a[j] > b[j]) return j;
+        return n;
+    }
+
+    template <class T>
+    __attribute__((target("avx2")))
+    inline void addAvx2Narrow(T* dst, const T* src, int n) {
+        const int lanes = 32 / sizeof(T);
+        int j = 0;
+        for (; j + lanes <= n; j += lanes) {
+            __m256i va = _mm256_loadu_si256((const __m256i*)(dst + j));
+            __m256i vb = _mm256_loadu_si256((const __m256i*)(src + j));
+            __m256i v = sizeof(T) == 1 ? _mm256_adds_epu8(va, vb) : _mm256_adds_epu16(va, vb);
+            _mm256_storeu_si256((__m256i*)(dst + j), v);
+        }
+        for (; j < n; ++j) dst[j] = saturatingAdd(dst[j], src[j]);
+    }
+
+    template <class T>
+    __attribute__((target("avx2")))
+    inline void subtractAvx2Narrow(T* dst, const T* src, int n) {
+        const int lanes = 32 / sizeof(T);
+        int j = 0;
+        for (; j + lanes <= n; j += lanes) {
+            __m256i va = _mm256_loadu_si256((const __m256i*)(dst + j));
+            __m256i vb = _mm256_loadu_si256((const __m256i*)(src + j));
+            __m256i v = sizeof(T) == 1 ? _mm256_sub_epi8(va, vb) : _mm256_sub_epi16(va, vb);
+            _mm256_storeu_si256((__m256i*)(dst + j), v);
+        }
+        for (; j < n; ++j) dst[j] = (T)(dst[j] - src[j]);
+    }
+#endif
+
+    // Table of the implementations currently in use
+    struct Dispatch {
+        const char* name;
+        FirstExceedingFn firstExceeding;
+        UpdateFn add;
+        UpdateFn subtract;
+        bool avx2;          // AVX2 usable, for the narrow element type kernels
+    };
+
+    inline Dispatch scalarDispatch() {
+        Dispatch d = { "scalar", firstExceedingScalar, addScalar, subtractScalar, false };
+        return d;
+    }
+
+    // Pick an implementation by name ("scalar", "avx2", "avx512") or "auto" for the best supported.
+    // Returns false if the name is unknown or the CPU lacks the instruction set.
+    inline bool selectDispatch(const std::string& name, Dispatch& out) {
+        if (name == "scalar") { out = scalarDispatch(); return true; }
+#ifdef BANKERS_X86_SIMD
+        __builtin_cpu_init();
+        bool hasAvx512 = __builtin_cpu_supports("avx512f");
+        bool hasAvx2 = __builtin_cpu_supports("avx2");
+        if (name == "avx512" || (name == "auto" && hasAvx512)) {
+            if (!hasAvx512) return false;
+            Dispatch d = { "avx512", firstExceedingAvx512, addAvx512, subtractAvx512, hasAvx2 };
+            out = d;
+            return true;
+        }
+        if (name == "avx2" || (name == "auto" && hasAvx2)) {
+            if (!hasAvx2) return false;
+            Dispatch d = { "avx2", firstExceedingAvx2, addAvx2, subtractAvx2, true };
+            out = d;
+            return true;
+        }
+#endif
+        if (name == "auto") { out = scalarDispatch(); return true; }
+        return false;
+    }
+
+    inline Dispatch autoDispatch() {
+        Dispatch d = scalarDispatch();
+        selectDispatch("auto", d);
+        return d;
+    }
+
+    inline Dispatch& active() {
+        static Dispatch current = autoDispatch();
+        return current;
+    }
+
+    // Override the automatic choice (e.g. to benchmark or cross-check the scalar path)
+    inline bool force(const std::string& name) {
+        return selectDispatch(name, active());
+    }
+
+    // Entry points used by BankersAlgorithm. Short rows are not worth an indirect call.
+    const int kVectorThreshold = 8;
+
+    inline int firstExceeding(const int* a, const int* b, int n) {
+        if (n < kVectorThreshold) return firstExceedingScalar(a, b, n);
+        return active().firstExceeding(a, b, n);
+    }
+
+    inline bool lessEqual(const int* a, const int* b, int n) {
+        return firstExceeding(a, b, n) == n;
+    }
+
+    inline void add(int* dst, const int* src, int n) {
+        if (n < kVectorThreshold) addScalar(dst, src, n);
+        else active().add(dst, src, n);
+    }
+
+    inline void subtract(int* dst, const int* src, int n) {
+        if (n < kVectorThreshold) subtractScalar(dst, src, n);
+        else active().subtract(dst, src, n);
+    }
+
+    // The same operations on the other element types (see BasicBankersAlgorithm): uint8_t and
+    // uint16_t use the AVX2 kernels above when the CPU has them, with saturating adds; int64_t
+    // stays scalar. Narrow rows are vectorized from one register's worth of lanes.
+    template <class T>
+    inline int firstExceeding(const T* a, const T* b, int n) {
+#ifdef BANKERS_X86_SIMD
+        if constexpr (sizeof(T) <= 2) {
+            if (n >= (int)(32 / sizeof(T)) && active().avx2) return firstExceedingAvx2Narrow(a, b, n);
+        }
+#endif
+        for (int j = 0; j < n; ++j) if (a[j] > b[j]) return j;
+        return n;
+    }
+
+    template <class T>
+    inline bool lessEqual(const T* a, const T* b, int n) {
+        return firstExceeding(a, b, n) == n;
+    }
+
+    template <class T>
+    inline void add(T* dst, const T* src, int n) {
+        if constexpr (sizeof(T) <= 2) {
+#ifdef BANKERS_X86_SIMD
+            if (n >= (int)(32 / sizeof(T)) && active().avx2) { addAvx2Narrow(dst, src, n); return; }
+#endif
+            for (int j = 0; j < n; ++j) dst[j] = saturatingAdd(dst[j], src[j]);
+        } else {
+            for (int j = 0; j < n; ++j) dst[j] += src[j];
+        }
+    }
+
+    template <class T>
+    inline void subtract(T* dst, const T* src, int n) {
+#ifdef BANKERS_X86_SIMD
+        if constexpr (sizeof(T) <= 2) {
+            if (n >= (int)(32 / sizeof(T)) && active().avx2) { subtractAvx2Narrow(dst, src, n); return; }
+        }
+#endif
+        for (int j = 0; j < n; ++j) dst[j] = (T)(dst[j] - src[j]);
+    }
+
+    // Variants for rows whose length N is known at compile time (FixedBankersAlgorithm<N>): no call
+    // through the dispatch table, and a constant trip count the compiler fully unrolls. The
+    // comparison is branch-free within groups of four (one SSE register) and exits between groups.
+    template <int N, class T>
+    inline bool lessEqualFixed(const T* a, const T* b) {
+        for (int j = 0; j < N; j += 4) {
+            bool fits = true;
+            for (int k = j; k < j + 4 && k < N; ++k) fits &= a[k] <= b[k];
+            if (!fits) return false;
+        }
+        return true;
+    }
+
+    template <int N, class T>
+    inline void addFixed(T* dst, const T* src) {
+        if constexpr (sizeof(T) <= 2) {
+            for (int j = 0; j < N; ++j) dst[j] = saturatingAdd(dst[j], src[j]);
+        } else {
+            for (int j = 0; j < N; ++j) dst[j] += src[j];
+        }
+    }
+
+    template <int N, class T>
+    inline void subtractFixed(T* dst, const T* src) {
+        for (int j = 0; j < N; ++j) dst[j] = (T)(dst[j] - src[j]);
+    }
+}
+
+// Scanner over the whole input. Regular files are mmap'd, anything else (pipes, terminals) is
+// read in large blocks; tokens and integers are then scanned in place without iostreams.
+// Line and column numbers are only computed when an error message needs them.
+class InputScanner {
+    private:
+        const char* begin = nullptr;     // Start of the input
+        const char* cur = nullptr;       // Next unread byte
+        const char* end = nullptr;       // One past the last byte
+        const char* last = nullptr;      // Start of the most recently scanned token
+        void* mapping = nullptr;         // mmap'd input, if the input is a regular file
+        size_t mappingSize = 0;
+        std::vector<char> buffer;        // Block-read input otherwise
+
+        static bool isSpace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+        void skipSpace() {
+            while (cur < end && isSpace(*cur)) ++cur;
+        }
+
+    public:
+        InputScanner() {}
+        InputScanner(const InputScanner&) = delete;
+        InputScanner& operator=(const InputScanner&) = delete;
+        ~InputScanner() {
+            if (mapping) munmap(mapping, mappingSize);
+        }
+
+        // Load everything readable from fd
+        bool open(int fd) {
+            struct stat st;
+            if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+                void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+                    mapping = p;
+                    mappingSize = (size_t)st.st_size;
+                    begin = (const char*)p;
+                    cur = last = begin;
+                    end = begin + mappingSize;
+                    return true;
+                }
+            }
+
+            const size_t blockSize = 1 << 20;
+            size_t used = 0;
+            while (true) {
+                if (buffer.size() - used < blockSize) buffer.resize(used + blockSize);
+                ssize_t n = read(fd, buffer.data() + used, buffer.size() - used);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                if (n == 0) break;
+                used += (size_t)n;
+            }
+            begin = buffer.data();
+            cur = last = begin;
+            end = begin + used;
+            return true;
+        }
+
+        // Scan a caller-owned buffer, which must outlive the scanner
+        void openBuffer(const char* data, size_t size) {
+            begin = cur = last = data;
+            end = data + size;
+        }
+
+        // True once only whitespace remains
+        bool atEnd() {
+            skipSpace();
+            return cur == end;
+        }
+
+        // Next whitespace-delimited token; the view points into the input buffer
+        bool nextToken(std::string_view& token) {
+            skipSpace();
+            last = cur;
+            if (cur == end) return false;
+            while (cur < end && !isSpace(*cur)) ++cur;
+            token = std::string_view(last, (size_t)(cur - last));
+            return true;
+        }
+
+        // Next token as a decimal int. On failure nothing is consumed.
+        bool nextInt(int& value) {
+            skipSpace();
+            last = cur;
+            const char* p = cur;
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+            const char* digits = p;
+            unsigned long long v = 0;
+            while (p < end && (unsigned)(*p - '0') < 10) {
+                v = v * 10 + (unsigned)(*p - '0');
+                if (v > 2147483648ULL) return false;
+                ++p;
+            }
+            if (p == digits || (p < end && !isSpace(*p))) return false;
+            if (v > 2147483647ULL && !negative) return false;
+            value = negative ? (int)(0 - v) : (int)v;
+            cur = p;
+            return true;
+        }
+
+        // Text of the most recent token, for error messages
+        std::string lastToken() const {
+            const char* p = last;
+            while (p < end && !isSpace(*p)) ++p;
+            return std::string(last, p);
+        }
+
+        // "line L, column C" of the most recent token (1-based)
+        std::string location() const {
+            int line = 1;
+            const char* lineStart = begin;
+            for (const char* p = begin; p < last; ++p) {
+                if (*p == '\n') { ++line; lineStart = p + 1; }
+            }
+            return "line " + std::to_string(line) + ", column " + std::to_string(last - lineStart + 1);
+        }
+};
+
+// Buffered formatter for matrix output. Whole rows are rendered into one large buffer with a
+// two-digits-at-a-time integer conversion and handed to the stream in big chunks, instead of one
+// operator<< per number. Writes go through the stream, so ordering with other output is preserved.
+class RowWriter {
+    private:
+        std::ostream& os;
+        std::vector<char> buffer;
+        size_t used = 0;
+
+        static const size_t kMaxIntChars = 11;    // "-2147483648"
+
+        void reserve(size_t n) {
+            if (buffer.size() - used < n) flush();
+        }
+
+    public:
+        explicit RowWriter(std::ostream& stream, size_t capacity = 1 << 16)
+            : os(stream), buffer(capacity < 64 ? 64 : capacity) {}
+        RowWriter(const RowWriter&) = delete;
+        RowWriter& operator=(const RowWriter&) = delete;
+        ~RowWriter() { flush(); }
+
+        void put(char c) {
+            reserve(1);
+            buffer[used++] = c;
+        }
+
+        void text(std::string_view s) {
+            if (s.size() > buffer.size()) {
+                flush();
+                os.write(s.data(), (std::streamsize)s.size());
+                return;
+            }
+            reserve(s.size());
+            memcpy(buffer.data() + used, s.data(), s.size());
+            used += s.size();
+        }
+
+        void line(std::string_view s) {
+            text(s);
+            put('\n');
+        }
+
+        void integer(int value) {
+            static const char digitPairs[] =
+                "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                "8081828384858687888990919293949596979899";
+            reserve(kMaxIntChars);
+            char tmp[kMaxIntChars];
+            char* p = tmp + kMaxIntChars;
+            unsigned int v = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+            while (v >= 100) {
+                unsigned int pair = (v % 100) * 2;
+                v /= 100;
+                *--p = digitPairs[pair + 1];
+                *--p = digitPairs[pair];
+            }
+            if (v >= 10) {
+                *--p = digitPairs[v * 2 + 1];
+                *--p = digitPairs[v * 2];
+            } else {
+                *--p = (char)('0' + v);
+            }
+            if (value < 0) *--p = '-';
+            size_t n = (size_t)(tmp + kMaxIntChars - p);
+            memcpy(buffer.data() + used, p, n);
+            used += n;
+        }
+
+        // 64-bit values, from states whose Work sums outgrow an int; rare, so not optimized
+        void integer(int64_t value) {
+            if (value >= INT_MIN && value <= INT_MAX) integer((int)value);
+            else text(std::to_string(value));
+        }
+
+        // numRows rows of numCols space-separated values, each ending in '\n'
+        template <class T>
+        void rows(const T* values, int numRows, int numCols) {
+            for (int i = 0; i < numRows; ++i) {
+                const T* row = values + (size_t)i * (size_t)numCols;
+                for (int j = 0; j < numCols; ++j) {
+                    if (j) put(' ');
+                    integer(row[j]);
+                }
+                put('\n');
+            }
+        }
+
+        void flush() {
+            if (used) os.write(buffer.data(), (std::streamsize)used);
+            used = 0;
+        }
+};
+
+// Binary snapshot of a Banker's state: a fixed header followed by the raw int32 arrays
+// Available (R), Max, Allocation and Need (P x R each, row-major), in host byte order.
+// Loading maps the file and copies each array straight into the matrix storage.
+namespace snapshot {
+    const char kMagic[8] = { 'B', 'A', 'N', 'K', 'S', 'N', 'A', 'P' };
+    const uint32_t kVersion = 1;
+    const uint32_t kByteOrderMark = 0x01020304;   // reads back differently on a foreign-endian host
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t headerSize;          // sizeof(Header), so later versions can grow it
+        uint32_t numResources;
+        uint32_t numProcesses;
+        uint32_t reserved;
+        uint64_t payloadChecksum;     // checksum of the four arrays, in file order
+        uint64_t headerChecksum;      // checksum of this header with headerChecksum = 0
+    };
+
+    static_assert(sizeof(int) == 4, "snapshots store resource counts as 32-bit ints");
+    static_assert(sizeof(Header) == 48, "snapshot header layout must not depend on the compiler");
+
+    // 64-bit FNV-style hash over 8-byte words, four independent lanes so it runs near memory
+    // bandwidth. seed lets several buffers be chained into one checksum.
+    inline uint64_t checksum(const void* data, size_t size, uint64_t seed) {
+        const uint64_t prime = 0x100000001b3ULL;
+        const unsigned char* p = (const unsigned char*)data;
+        uint64_t lane[4] = { seed ^ 0xcbf29ce484222325ULL, seed + 1, seed + 2, seed + 3 };
+        size_t k = 0;
+        for (; k + 32 <= size; k += 32) {
+            for (int l = 0; l < 4; ++l) {
+                uint64_t w;
+                memcpy(&w, p + k + 8 * l, 8);
+                lane[l] = (lane[l] ^ w) * prime;
+            }
+        }
+        uint64_t h = seed ^ (uint64_t)size;
+        for (int l = 0; l < 4; ++l) h = (h ^ lane[l]) * prime;
+        for (; k < size; ++k) h = (h ^ p[k]) * prime;
+        return h ^ (h >> 29);
+    }
+
+    inline uint64_t headerChecksum(Header header) {
+        header.headerChecksum = 0;
+        return checksum(&header, sizeof(header), 0);
+    }
+}
+
+// Safe sequence found by the last full safety check, kept up to date as rows change so that
+// isSafe() can usually answer without rerunning the safety algorithm.
+//
+// For the k-th process q of the sequence, slack(k) = (work before q runs) - need[q]; the sequence
+// still proves the state safe iff every slack is >= 0. When the process at position pos gains d
+// allocation (taken from Available), work drops by d at every position up to pos and is unchanged
+// after it, so slack(k) -= d for k < pos and slack(pos) changes by -d - (change in need[pos]).
+// Slacks are stored per position in blocks of kBlock, with a segment tree of lazy range adds over
+// the blocks: an update costs O(R * (kBlock + log P)) and the validity test reads the root in O(R).
+class SafeSequenceCache {
+    private:
+        static constexpr int kBlock = 32;
+        static constexpr int kPadding = 0x3fffffff;    // slack of the unused leaves past the last block
+
+        bool valid = false;
+        int numResources = 0;
+        std::vector<int> sequence;   // process order that proves the state safe
+        std::vector<int> position;   // pid -> index in sequence
+        Matrix slack;                // per position, excluding lazy adds still held in the tree
+        int leaves = 1;              // power of two >= number of blocks
+        Matrix treeMin;              // min slack over a subtree, including that node's own lazy add
+        Matrix treeLazy;             // add pending for the whole subtree below a node
+        std::vector<int> workDelta, pointDelta, rowMin;    // scratch rows
+
+        // Add delta to every block in [l, r) below node, which covers [nodeL, nodeR)
+        void rangeAdd(int node, int nodeL, int nodeR, int l, int r, const int* delta) {
+            if (r <= nodeL || nodeR <= l) return;
+            if (l <= nodeL && nodeR <= r) {
+                kernels::add(treeMin.row(node), delta, numResources);
+                kernels::add(treeLazy.row(node), delta, numResources);
+                return;
+            }
+            int mid = (nodeL + nodeR) / 2;
+            rangeAdd(2 * node, nodeL, mid, l, r, delta);
+            rangeAdd(2 * node + 1, mid, nodeR, l, r, delta);
+            pull(node);
+        }
+
+        void pull(int node) {
+            const int* left = treeMin.row(2 * node);
+            const int* right = treeMin.row(2 * node + 1);
+            const int* lazy = treeLazy.row(node);
+            int* out = treeMin.row(node);
+            for (int j = 0; j < numResources; ++j) out[j] = std::min(left[j], right[j]) + lazy[j];
+        }
+
+        // Recompute block b's leaf from its slack rows, then every ancestor
+        void refreshBlock(int b) {
+            int first = b * kBlock;
+            int last = std::min((int)sequence.size(), first + kBlock);
+            std::fill(rowMin.begin(), rowMin.end(), kPadding);
+            for (int k = first; k < last; ++k) {
+                const int* row = slack.row(k);
+                for (int j = 0; j < numResources; ++j) rowMin[j] = std::min(rowMin[j], row[j]);
+            }
+            int node = leaves + b;
+            int* leaf = treeMin.row(node);
+            const int* lazy = treeLazy.row(node);
+            for (int j = 0; j < numResources; ++j) leaf[j] = rowMin[j] + lazy[j];
+            for (node /= 2; node >= 1; node /= 2) pull(node);
+        }
+
+    public:
+        bool isValid() const { return valid; }
+        void invalidate() { valid = false; }
+        const std::vector<int>& order() const { return sequence; }
+
+        // Start over from a complete safe sequence of the given state. Slacks are ints whatever the
+        // state's element type; larger ones are capped at kPadding, which can only make holds()
+        // give up on the sequence early, never accept a broken one.
+        template <class T>
+        void rebuild(const std::vector<int>& order, const BasicMatrix<T>& need, const BasicMatrix<T>& allocation,
+                     const std::vector<T>& available) {
+            numResources = (int)available.size();
+            int count = (int)order.size();
+            sequence = order;
+            position.assign(count, 0);
+            for (int k = 0; k < count; ++k) position[order[k]] = k;
+
+            slack = Matrix(count, numResources);
+            if constexpr (std::is_same<T, int>::value) {
+                std::vector<int> work = available;
+                for (int k = 0; k < count; ++k) {
+                    int* row = slack.row(k);
+                    std::copy(work.begin(), work.end(), row);
+                    kernels::subtract(row, need.row(order[k]), numResources);
+                    kernels::add(work.data(), allocation.row(order[k]), numResources);
+                }
+            } else {
+                std::vector<int64_t> work(available.begin(), available.end());
+                for (int k = 0; k < count; ++k) {
+                    int* row = slack.row(k);
+                    const T* needRow = need.row(order[k]);
+                    const T* allocationRow = allocation.row(order[k]);
+                    for (int j = 0; j < numResources; ++j) {
+                        row[j] = (int)std::min<int64_t>(work[j] - needRow[j], kPadding);
+                        work[j] += allocationRow[j];
+                    }
+                }
+            }
+
+            int blocks = (count + kBlock - 1) / kBlock;
+            leaves = 1;
+            while (leaves < blocks) leaves *= 2;
+            treeMin = Matrix(2 * leaves, numResources);
+            treeLazy = Matrix(2 * leaves, numResources);
+            std::fill(treeMin.raw(), treeMin.raw() + treeMin.size(), kPadding);
+            workDelta.assign(numResources, 0);
+            pointDelta.assign(numResources, 0);
+            rowMin.assign(numResources, 0);
+            for (int b = 0; b < blocks; ++b) refreshBlock(b);
+            valid = true;
+        }
+
+        // True if the cached sequence still proves the current state safe
+        bool holds() const {
+            if (!valid) return false;
+            const int* root = treeMin.row(1);
+            for (int j = 0; j < numResources; ++j) if (root[j] < 0) return false;
+            return true;
+        }
+
+        // pid's allocation changed by allocDelta, with the opposite change to Available, and its
+        // need changed by needDelta (nullptr means -allocDelta, as for a grant or a release)
+        void noteChange(int pid, const int* allocDelta, const int* needDelta) {
+            if (!valid) return;
+            int pos = position[pid];
+            for (int j = 0; j < numResources; ++j) workDelta[j] = -allocDelta[j];
+
+            // Positions before pos see work change by -allocDelta: whole blocks through the tree,
+            // the rest of pos's own block directly
+            int block = pos / kBlock;
+            if (block > 0) rangeAdd(1, 0, leaves, 0, block, workDelta.data());
+            for (int k = block * kBlock; k < pos; ++k) kernels::add(slack.row(k), workDelta.data(), numResources);
+            if (needDelta) {
+                for (int j = 0; j < numResources; ++j) pointDelta[j] = workDelta[j] - needDelta[j];
+                kernels::add(slack.row(pos), pointDelta.data(), numResources);
+            }
+            refreshBlock(block);
+        }
+};
+
+// Why a request fails canRequest() or a release fails canRelease(), as reported by checkRequest()
+// and checkRelease() (WrongLength only by decideRequest()). Clients should give up on a request denied
+// for anything but ExceedsAvailable, which no later state can fix, and may retry ExceedsAvailable once
+// units are freed.
+enum class DenialReason : char {
+    None,                // the request can be considered
+    UnknownProcess,      // no such pid
+    NegativeCount,       // a negative count
+    ExceedsNeed,         // more than the process still needs
+    ExceedsAvailable,    // within need, but more than is available now
+    ExceedsAllocation,   // a release of more than the process holds
+    WrongLength          // not one count per resource
+};
+
+// Selects which implementation of the safety algorithm isSafe() runs
+enum class SafetyEngine {
+    Sweep,       // Reference: repeated passes over every process until no progress
+    Worklist,    // Blocked processes wait on one resource and are re-examined only when it grows
+    Parallel,    // Rounds over the unfinished processes, partitioned across a thread pool
+    CrossCheck   // Runs all of them, keeps the sweep's verdict and records any mismatch
+};
+
+// The verdicts of a CrossCheck run whose safety algorithms disagreed
+struct EngineDisagreement {
+    bool sweep;
+    bool worklist;
+    bool parallel;
+};
+
+// Fixed set of worker threads running the tasks of one parallel loop at a time.
+// The calling thread works on the loop too, so a pool of size N has N - 1 workers.
+class ThreadPool {
+    private:
+        std::vector<std::thread> workers;
+        std::mutex callLock;             // one parallelFor() at a time
+        std::mutex lock;                 // guards everything below
+        std::condition_variable wake;    // workers wait here for the next loop
+        std::condition_variable done;    // the caller waits here for the workers
+        const std::function<void(int)>* job = nullptr;
+        int jobTasks = 0;
+        std::atomic<int> nextTask{0};
+        int running = 0;                 // workers that haven't finished the current loop
+        unsigned long generation = 0;    // bumped for every loop
+        bool stopping = false;
+
+        void drain(const std::function<void(int)>& f, int tasks) {
+            for (int t = nextTask.fetch_add(1); t < tasks; t = nextTask.fetch_add(1)) f(t);
+        }
+
+        void workerLoop() {
+            unsigned long seen = 0;
+            std::unique_lock<std::mutex> guard(lock);
+            while (true) {
+                wake.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                const std::function<void(int)>* f = job;
+                int tasks = jobTasks;
+                guard.unlock();
+                drain(*f, tasks);
+                guard.lock();
+                if (--running == 0) done.notify_one();
+            }
+        }
+
+    public:
+        explicit ThreadPool(int threads) {
+            for (int t = 1; t < threads; ++t) workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread& w : workers) w.join();
+        }
+
+        int size() const { return (int)workers.size() + 1; }
+
+        // Run f(0) .. f(tasks - 1) across the pool and return once all of them have finished
+        void parallelFor(int tasks, const std::function<void(int)>& f) {
+            if (workers.empty() || tasks <= 1) {
+                for (int t = 0; t < tasks; ++t) f(t);
+                return;
+            }
+            std::lock_guard<std::mutex> call(callLock);
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                job = &f;
+                jobTasks = tasks;
+                nextTask = 0;
+                running = (int)workers.size();
+                ++generation;
+            }
+            wake.notify_all();
+            drain(f, tasks);
+            std::unique_lock<std::mutex> guard(lock);
+            done.wait(guard, [&] { return running == 0; });
+        }
+};
+
+// Banker's Algorithm implementation
+// Banker's algorithm state. Width is the number of resources when it is fixed at compile time
+// (FixedBankersAlgorithm<R>, see below): rows then have a constant length and stride, so the
+// per-resource loops of the safety check, canRequest() and applyRequest() unroll. Width 0
+// (BankersAlgorithm) takes the number of resources at run time and uses the dispatched kernels.
+//
+// T is the type of every count in the state: int as parsed, or uint8_t/uint16_t/int64_t when a
+// loaded state is converted to the narrowest type that holds it (see elementTypeFor()). Requests
+// and releases still arrive as ints.
+template <int Width, class T = int>
+class BasicBankersAlgorithm {
+    template <int, class> friend class BasicBankersAlgorithm;
+    private:
+        int numProcesses;                // Number of processes
+        int numResources;                // Number of resources
+        BasicMatrix<T> allocation;       // Allocation matrix
+        BasicMatrix<T> max;              // Maximum demand matrix
+        BasicMatrix<T> need;             // Need matrix
+        std::vector<T> available;        // Available resources
+        SafetyEngine engine = SafetyEngine::Sweep;  // Safety algorithm used by isSafe()
+        mutable std::vector<EngineDisagreement> disagreements;  // CrossCheck mismatches not yet taken
+        std::shared_ptr<ThreadPool> pool;  // Threads for the parallel engine (none: it runs serially)
+
+        // Incremental safety checking: the safe sequence of the last full check is updated on every
+        // grant, release and finish, and isSafe() only reruns the engine once that sequence breaks
+        bool incremental = false;
+        mutable SafeSequenceCache safeSequence;
+        std::vector<int> deltaScratch;   // scratch rows for keeping the cache in step
+
+        // Undo log for tentative grants. While a transaction is open, applyRequest() and release() save the
+        // Allocation and Need rows it is about to modify (2 * R cells per request) and the
+        // Available vector is saved once, so a rollback costs O(R) per request instead of a
+        // copy of the whole P x R state. Buffers keep their capacity between transactions.
+        bool inTransaction = false;
+        std::vector<int> undoPids;       // pid of each logged request, in apply order
+        std::vector<T> undoRows;         // allocation row then need row for each logged request
+        std::vector<T> undoAvailable;    // Available at beginTransaction()
+
+        // A Work vector: a std::array when the width is fixed, so it lives on the stack
+        typedef typename std::conditional<(Width > 0), std::array<T, (Width > 0 ? Width : 1)>,
+                                          std::vector<T>>::type WorkRow;
+
+        // Number of resources, as a constant when the width is fixed
+        int width() const { return Width > 0 ? Width : numResources; }
+
+        // Row i of a P x R matrix, with a compile-time stride when the width is fixed
+        const T* rowOf(const BasicMatrix<T>& m, int i) const { return m.raw() + (size_t)i * width(); }
+        T* rowOf(BasicMatrix<T>& m, int i) const { return m.raw() + (size_t)i * width(); }
+
+        WorkRow workFrom(const T* values) const {
+            WorkRow work;
+            if constexpr (Width == 0) work.resize(numResources);
+            std::copy(values, values + width(), work.begin());
+            return work;
+        }
+
+        // Per-resource row operations: unrolled when the width is fixed, dispatched kernels otherwise
+        bool rowLessEqual(const T* a, const T* b) const {
+            if constexpr (Width > 0) return kernels::lessEqualFixed<Width>(a, b);
+            else return kernels::lessEqual(a, b, numResources);
+        }
+
+        void rowAdd(T* dst, const T* src) const {
+            if constexpr (Width > 0) kernels::addFixed<Width>(dst, src);
+            else kernels::add(dst, src, numResources);
+        }
+
+        void rowSubtract(T* dst, const T* src) const {
+            if constexpr (Width > 0) kernels::subtractFixed<Width>(dst, src);
+            else kernels::subtract(dst, src, numResources);
+        }
+
+        // Index of the first j >= from with a[j] > b[j], or the width if there is none
+        int firstExceedingFrom(const T* a, const T* b, int from) const {
+            if constexpr (Width > 0) {
+                for (int j = from; j < Width; ++j) if (a[j] > b[j]) return j;
+                return Width;
+            } else {
+                return from + kernels::firstExceeding(a + from, b + from, numResources - from);
+            }
+        }
+
+        // Request and release vectors arrive as ints; these compare and apply them to rows of T.
+        // Values that passed canRequest() or canRelease() fit in T.
+        bool intsFit(const int* values, const T* limit) const {
+            if constexpr (std::is_same<T, int>::value) {
+                return rowLessEqual(values, limit);
+            } else {
+                for (int j = 0; j < width(); ++j) if (values[j] > limit[j]) return false;
+                return true;
+            }
+        }
+
+        void addInts(T* dst, const int* values) const {
+            if constexpr (std::is_same<T, int>::value) rowAdd(dst, values);
+            else for (int j = 0; j < width(); ++j) dst[j] = (T)(dst[j] + values[j]);
+        }
+
+        void subtractInts(T* dst, const int* values) const {
+            if constexpr (std::is_same<T, int>::value) rowSubtract(dst, values);
+            else for (int j = 0; j < width(); ++j) dst[j] = (T)(dst[j] - values[j]);
+        }
+    public:
+        typedef T Value;
+
+
+        BasicBankersAlgorithm(int processes, int resources)      // Constructor to initialize the matrices and vectors
+            : numProcesses(processes), numResources(resources),
+              allocation(processes, resources), max(processes, resources), need(processes, resources),
+              available(resources, 0) {}
+
+        // Take over the matrices of a state as parsed (resource count must equal Width, unless
+        // Width is 0, and every value must fit in T). Engine, threads and incremental mode are not
+        // carried over.
+        static BasicBankersAlgorithm adopt(BasicBankersAlgorithm<0>&& state) {
+            if constexpr (std::is_same<T, int>::value) {
+                BasicBankersAlgorithm out(0, 0);
+                out.numProcesses = state.numProcesses;
+                out.numResources = state.numResources;
+                out.allocation = std::move(state.allocation);
+                out.max = std::move(state.max);
+                out.need = std::move(state.need);
+                out.available = std::move(state.available);
+                return out;
+            } else {
+                BasicBankersAlgorithm out(state.numProcesses, state.numResources);
+                std::copy(state.allocation.raw(), state.allocation.raw() + state.allocation.size(), out.allocation.raw());
+                std::copy(state.max.raw(), state.max.raw() + state.max.size(), out.max.raw());
+                std::copy(state.need.raw(), state.need.raw() + state.need.size(), out.need.raw());
+                std::copy(state.available.begin(), state.available.end(), out.available.begin());
+                state = BasicBankersAlgorithm<0>(0, 0);
+                return out;
+            }
+        }
+
+        int processCount() const { return numProcesses; }
+        int resourceCount() const { return numResources; }
+
+        // Write the full state (including Need) as a binary snapshot. Returns false with a reason on failure.
+        bool saveSnapshot(const std::string& path, std::string& error) const {
+            static_assert(std::is_same<T, int>::value, "snapshots hold int32 counts");
+            const size_t matrixBytes = need.size() * sizeof(int);
+            const void* sections[4] = { available.data(), max.raw(), allocation.raw(), need.raw() };
+            const size_t sizes[4] = { available.size() * sizeof(int), matrixBytes, matrixBytes, matrixBytes };
+
+            snapshot::Header header;
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, snapshot::kMagic, sizeof(header.magic));
+            header.version = snapshot::kVersion;
+            header.byteOrder = snapshot::kByteOrderMark;
+            header.headerSize = sizeof(header);
+            header.numResources = (uint32_t)numResources;
+            header.numProcesses = (uint32_t)numProcesses;
+            uint64_t sum = 0;
+            for (int k = 0; k < 4; ++k) sum = snapshot::checksum(sections[k], sizes[k], sum);
+            header.payloadChecksum = sum;
+            header.headerChecksum = snapshot::headerChecksum(header);
+
+            FILE* f = fopen(path.c_str(), "wb");
+            if (!f) { error = strerror(errno); return false; }
+            bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+            for (int k = 0; k < 4 && ok; ++k) ok = fwrite(sections[k], 1, sizes[k], f) == sizes[k];
+            if (fclose(f) != 0) ok = false;
+            if (!ok) error = "write failed";
+            return ok;
+        }
+
+        // Replace out with the state stored in a snapshot. The file is mmap'd, validated against its
+        // header (magic, version, byte order, size, checksums) and copied into fresh matrices.
+        static bool loadSnapshot(const std::string& path, BasicBankersAlgorithm& out, std::string& error) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) { error = strerror(errno); return false; }
+            struct stat st;
+            if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(snapshot::Header)) {
+                close(fd);
+                error = "file too small for a snapshot header";
+                return false;
+            }
+            size_t fileSize = (size_t)st.st_size;
+            void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (mapping == MAP_FAILED) { error = strerror(errno); return false; }
+            madvise(mapping, fileSize, MADV_SEQUENTIAL);
+
+            bool ok = loadSnapshotBytes((const char*)mapping, fileSize, out, error);
+            munmap(mapping, fileSize);
+            return ok;
+        }
+
+        // Raw storage for parsers that fill the matrices in place (row-major, P x R)
+        T* availableData() { return available.data(); }
+        T* maxData() { return max.raw(); }
+        T* allocationData() { return allocation.raw(); }
+        const T* availableData() const { return available.data(); }
+        const T* maxData() const { return max.raw(); }
+        const T* allocationData() const { return allocation.raw(); }
+
+        // Setters so main can populate the matrices after parsing input
+        void setAvailable(const std::vector<int>& av) {
+            if ((int)av.size() != numResources) return;
+            safeSequence.invalidate();
+            available.assign(av.begin(), av.end());
+        }
+
+        void setMaxRow(int pid, const std::vector<int>& row) {
+            if (pid < 0 || pid >= numProcesses) return;
+            if ((int)row.size() != numResources) return;
+            safeSequence.invalidate();
+            max.setRow(pid, row);
+        }
+
+        void setAllocationRow(int pid, const std::vector<int>& row) {
+            if (pid < 0 || pid >= numProcesses) return;
+            if ((int)row.size() != numResources) return;
+            safeSequence.invalidate();
+            allocation.setRow(pid, row);
+        }
+
+        // Compute need = max - allocation for each process/resource
+        void computeNeed() {
+            safeSequence.invalidate();
+            const T* m = max.raw();
+            const T* a = allocation.raw();
+            T* n = need.raw();
+            for (size_t k = 0; k < need.size(); ++k) {
+                n[k] = m[k] > a[k] ? (T)(m[k] - a[k]) : 0; // guard against allocation > max
+            }
+        }
+
+        void setEngine(SafetyEngine e) { engine = e; }
+
+        // Move the mismatches the CrossCheck engine found since the last call into found, oldest first
+        void takeEngineDisagreements(std::vector<EngineDisagreement>& found) {
+            found.swap(disagreements);
+            disagreements.clear();
+        }
+
+        // Thread pool used by the parallel engine; threads <= 1 makes it run on the caller alone
+        void setThreads(int threads) {
+            if (threads > 1) pool = std::make_shared<ThreadPool>(threads);
+            else pool.reset();
+        }
+
+        void setIncremental(bool on) {
+            incremental = on;
+            safeSequence.invalidate();
+        }
+
+        // Safety algorithm: returns true if the current state is safe.
+        // In incremental mode the cached safe sequence is tried first; the engine only runs when
+        // the sequence no longer holds, and a new safe sequence it finds replaces the cached one.
+        bool isSafe() const {
+            if (!incremental) return runEngine(nullptr, nullptr);
+            if (safeSequence.holds()) return true;
+            std::vector<int> order;
+            if (!runEngine(&order, nullptr)) return false;
+            safeSequence.rebuild(order, need, allocation, available);
+            return true;
+        }
+
+        // Safety algorithm that also reports the safe sequence, i.e. the order in which the processes
+        // can finish, and optionally the Work vector after each of them finishes (R values per step,
+        // appended to workTrace). Both come out of the same single run of the safety algorithm.
+        // For an unsafe state they describe the processes that could finish before it got stuck.
+        bool isSafe(std::vector<int>& sequence, std::vector<T>* workTrace = nullptr) const {
+            if (incremental && safeSequence.holds()) {
+                sequence = safeSequence.order();
+                if (workTrace) {
+                    workTrace->clear();
+                    WorkRow work = workFrom(available.data());
+                    for (int pid : sequence) {
+                        rowAdd(work.data(), rowOf(allocation, pid));
+                        workTrace->insert(workTrace->end(), work.begin(), work.end());
+                    }
+                }
+                return true;
+            }
+            bool safe = runEngine(&sequence, workTrace);
+            if (incremental && safe) safeSequence.rebuild(sequence, need, allocation, available);
+            return safe;
+        }
+
+        // Run the selected safety algorithm. If order is given it receives the processes in the
+        // order they were able to finish (a complete safe sequence when the state is safe), and
+        // trace the Work vector after each of them.
+        bool runEngine(std::vector<int>* order, std::vector<T>* trace) const {
+            switch (engine) {
+                case SafetyEngine::Worklist:
+                    return isSafeWorklist(order, trace);
+                case SafetyEngine::Parallel:
+                    return isSafeParallel(order, trace);
+                case SafetyEngine::CrossCheck: {
+                    bool sweep = isSafeSweep(order, trace);
+                    bool worklist = isSafeWorklist(nullptr, nullptr);
+                    bool parallel = isSafeParallel(nullptr, nullptr);
+                    if (sweep != worklist || sweep != parallel) {
+                        disagreements.push_back(EngineDisagreement{ sweep, worklist, parallel });
+                    }
+                    return sweep;
+                }
+                case SafetyEngine::Sweep:
+                default:
+                    return isSafeSweep(order, trace);
+            }
+        }
+
+        // Reference safety algorithm: sweep all unfinished processes until a full pass makes no progress.
+        // O(P^2 * R) in the worst case (processes unlocking one at a time in reverse order). The
+        // unfinished processes are kept in a list compacted during each pass, so later passes skip
+        // finished ones; the compaction is stable to keep the classic pid-order safe sequence.
+        bool isSafeSweep(std::vector<int>* order = nullptr, std::vector<T>* trace = nullptr) const {
+            WorkRow work = workFrom(available.data());
+            std::vector<int> live(numProcesses);
+            for (int i = 0; i < numProcesses; ++i) live[i] = i;
+            if (order) order->clear();
+            if (trace) trace->clear();
+
+            while (!live.empty()) {
+                size_t kept = 0;
+                for (int i : live) {
+                    if (rowLessEqual(rowOf(need, i), work.data())) {
+                        // this process can finish
+                        rowAdd(work.data(), rowOf(allocation, i));
+                        if (order) order->push_back(i);
+                        if (trace) trace->insert(trace->end(), work.begin(), work.end());
+                    } else {
+                        live[kept++] = i;
+                    }
+                }
+                if (kept == live.size()) break;     // no progress
+                live.resize(kept);
+            }
+
+            return live.empty();
+        }
+
+        // Worklist safety algorithm. Each unfinished process is parked on the first resource whose
+        // need exceeds work, in a per-resource min-heap keyed by that need. When a process finishes
+        // and work[j] grows, only the heap for j is drained, and each popped process resumes its scan
+        // from the resource it was blocked on (work never shrinks, so earlier resources stay satisfied).
+        // Every (process, resource) pair is passed at most once: O(P * R + P * R * log P) overall.
+        bool isSafeWorklist(std::vector<int>* order = nullptr, std::vector<T>* trace = nullptr) const {
+            return worklistSafety(CurrentRows(*this), available.data(), order, trace);
+        }
+
+        // The worklist algorithm over any view of the Need and Allocation rows (see CurrentRows,
+        // AdjustedRows), so what-if checks can run it on a modified state without copying it
+        template <class Rows>
+        bool worklistSafety(const Rows& rows, const T* availableRow, std::vector<int>* order,
+                            std::vector<T>* trace) const {
+            typedef std::pair<T, int> Waiter;                          // (need on the blocking resource, pid)
+            WorkRow work = workFrom(availableRow);
+            std::vector<int> cursor(numProcesses, 0);                  // first resource not yet known satisfied
+            std::vector<std::vector<Waiter>> blocked(numResources);    // min-heaps of waiters per resource
+            std::vector<int> ready;                                    // processes whose whole need fits in work
+            ready.reserve(numProcesses);
+
+            // Resume pid's scan at its cursor and either mark it ready or park it on the blocker
+            auto examine = [&](int pid) {
+                const T* needRow = rows.need(pid);
+                int j = firstExceedingFrom(needRow, work.data(), cursor[pid]);
+                cursor[pid] = j;
+                if (j == numResources) {
+                    ready.push_back(pid);
+                } else {
+                    blocked[j].push_back(Waiter(needRow[j], pid));
+                    std::push_heap(blocked[j].begin(), blocked[j].end(), std::greater<Waiter>());
+                }
+            };
+
+            for (int i = 0; i < numProcesses; ++i) examine(i);
+
+            int finished = 0;
+            if (order) order->clear();
+            if (trace) trace->clear();
+            while (!ready.empty()) {
+                int i = ready.back();
+                ready.pop_back();
+                ++finished;
+                if (order) order->push_back(i);
+
+                // this process can finish: return its allocation, then wake waiters it satisfies.
+                // A woken process only moves on to higher resources, whose heaps are drained later
+                // in this same loop if they grew.
+                const T* allocRow = rows.allocation(i);
+                rowAdd(work.data(), allocRow);
+                if (trace) trace->insert(trace->end(), work.begin(), work.end());
+                for (int j = 0; j < width(); ++j) {
+                    if (allocRow[j] == 0) continue;
+                    std::vector<Waiter>& heap = blocked[j];
+                    while (!heap.empty() && heap.front().first <= work[j]) {
+                        std::pop_heap(heap.begin(), heap.end(), std::greater<Waiter>());
+                        int waiter = heap.back().second;
+                        heap.pop_back();
+                        examine(waiter);
+                    }
+                }
+            }
+
+            return finished == numProcesses;
+        }
+
+        // Parallel safety algorithm. Each round tests every unfinished process against the Work of
+        // the round's start, with the unfinished list split into chunks across the thread pool; each
+        // chunk sums the allocations of its runnable processes, and the partial sums are reduced into
+        // Work before the next round. Work only grows, so the verdict matches the serial sweep; the
+        // safe sequence lists each round's runnable processes in pid order.
+        bool isSafeParallel(std::vector<int>* order = nullptr, std::vector<T>* trace = nullptr) const {
+            const size_t kGrain = 2048;      // unfinished processes per chunk worth a thread
+            WorkRow work = workFrom(available.data());
+            std::vector<int> live(numProcesses);
+            for (int i = 0; i < numProcesses; ++i) live[i] = i;
+            int threads = pool ? pool->size() : 1;
+            std::vector<std::vector<int>> runnable(threads);
+            std::vector<std::vector<T>> gained(threads, std::vector<T>(numResources, 0));
+            std::vector<char> finished(numProcesses, 0);
+            if (order) order->clear();
+            if (trace) trace->clear();
+
+            while (!live.empty()) {
+                int chunks = (int)std::min((size_t)threads, std::max((size_t)1, live.size() / kGrain));
+                size_t perChunk = (live.size() + chunks - 1) / chunks;
+                std::function<void(int)> scan = [&](int c) {
+                    runnable[c].clear();
+                    std::fill(gained[c].begin(), gained[c].end(), 0);
+                    size_t first = c * perChunk;
+                    size_t last = std::min(live.size(), first + perChunk);
+                    for (size_t k = first; k < last; ++k) {
+                        int i = live[k];
+                        if (rowLessEqual(rowOf(need, i), work.data())) {
+                            runnable[c].push_back(i);
+                            rowAdd(gained[c].data(), rowOf(allocation, i));
+                        }
+                    }
+                };
+                if (chunks > 1) pool->parallelFor(chunks, scan);
+                else scan(0);
+
+                // Reduce the chunks into Work; with a trace, step through the processes one by one
+                bool progressed = false;
+                for (int c = 0; c < chunks; ++c) {
+                    for (int i : runnable[c]) {
+                        finished[i] = 1;
+                        if (order) order->push_back(i);
+                        if (trace) {
+                            rowAdd(work.data(), rowOf(allocation, i));
+                            trace->insert(trace->end(), work.begin(), work.end());
+                        }
+                    }
+                    if (!runnable[c].empty()) {
+                        progressed = true;
+                        if (!trace) rowAdd(work.data(), gained[c].data());
+                    }
+                }
+                if (!progressed) break;
+
+                size_t kept = 0;
+                for (size_t k = 0; k < live.size(); ++k) if (!finished[live[k]]) live[kept++] = live[k];
+                live.resize(kept);
+            }
+
+            return live.empty();
+        }
+
+        // Rows of the current state
+        struct CurrentRows {
+            const BasicBankersAlgorithm& state;
+            explicit CurrentRows(const BasicBankersAlgorithm& s) : state(s) {}
+            const T* need(int i) const { return state.rowOf(state.need, i); }
+            const T* allocation(int i) const { return state.rowOf(state.allocation, i); }
+        };
+
+        // Rows of the current state with one process's rows replaced
+        struct AdjustedRows {
+            const BasicBankersAlgorithm& state;
+            int pid;
+            const T* needRow;
+            const T* allocationRow;
+            AdjustedRows(const BasicBankersAlgorithm& s, int p, const T* n, const T* a)
+                : state(s), pid(p), needRow(n), allocationRow(a) {}
+            const T* need(int i) const { return i == pid ? needRow : state.rowOf(state.need, i); }
+            const T* allocation(int i) const { return i == pid ? allocationRow : state.rowOf(state.allocation, i); }
+        };
+
+        // What-if check: would granting req to pid leave the system safe? The object is not modified;
+        // the request lives in a per-call delta (scratch holds the adjusted rows), so any number of
+        // threads can evaluate requests against the same state at once. Assumes canRequest() passed.
+        bool isSafeAfter(int pid, const std::vector<int>& req, std::vector<T>& scratch) const {
+            scratch.resize(3 * (size_t)numResources);
+            T* adjustedAvailable = scratch.data();
+            T* adjustedNeed = adjustedAvailable + numResources;
+            T* adjustedAllocation = adjustedNeed + numResources;
+            std::copy(available.begin(), available.end(), adjustedAvailable);
+            std::copy(need.row(pid), need.row(pid) + numResources, adjustedNeed);
+            std::copy(allocation.row(pid), allocation.row(pid) + numResources, adjustedAllocation);
+            subtractInts(adjustedAvailable, req.data());
+            subtractInts(adjustedNeed, req.data());
+            addInts(adjustedAllocation, req.data());
+            return worklistSafety(AdjustedRows(*this, pid, adjustedNeed, adjustedAllocation),
+                                  adjustedAvailable, nullptr, nullptr);
+        }
+
+        // Check if a request can be considered: 0 <= req <= need and req <= available
+        bool canRequest(int pid, const std::vector<int>& req) const {
+            if (pid < 0 || pid >= numProcesses) return false;
+            if constexpr (!std::is_same<T, int>::value) {
+                // the int request against both rows of T in a single pass
+                const T* needRow = rowOf(need, pid);
+                for (int j = 0; j < width(); ++j) {
+                    if (req[j] < 0 || req[j] > needRow[j] || req[j] > available[j]) return false;
+                }
+                return true;
+            }
+            int signs = 0;
+            for (int j = 0; j < numResources; ++j) signs |= req[j];
+            if (signs < 0) return false;
+
+            return intsFit(req.data(), rowOf(need, pid)) && intsFit(req.data(), available.data());
+        }
+
+        // Why canRequest() rejects req: the first negative count, else the first resource over need,
+        // else the first over Available (resource gets its index). Off the hot path: call it only to
+        // explain a denial.
+        DenialReason checkRequest(int pid, const std::vector<int>& req, int& resource) const {
+            resource = -1;
+            if (pid < 0 || pid >= numProcesses) return DenialReason::UnknownProcess;
+            const T* needRow = rowOf(need, pid);
+            for (int j = 0; j < numResources; ++j) {
+                if (req[j] < 0) { resource = j; return DenialReason::NegativeCount; }
+            }
+            for (int j = 0; j < numResources; ++j) {
+                if (req[j] > needRow[j]) { resource = j; return DenialReason::ExceedsNeed; }
+            }
+            for (int j = 0; j < numResources; ++j) {
+                if (req[j] > available[j]) { resource = j; return DenialReason::ExceedsAvailable; }
+            }
+            return DenialReason::None;
+        }
+
+        // Apply the request (assumes it's valid, see canRequest). Modifies allocation, available, need.
+        // Need is kept exactly at max - allocation, so a logged request can be undone bit for bit.
+        void applyRequest(int pid, const std::vector<int>& req) {
+            if (pid < 0 || pid >= numProcesses) return;
+            logRows(pid);
+            safeSequence.noteChange(pid, req.data(), nullptr);
+            if constexpr (!std::is_same<T, int>::value) {
+                T* __restrict allocationRow = rowOf(allocation, pid);
+                T* __restrict needRow = rowOf(need, pid);
+                T* __restrict availableRow = available.data();
+                const int* __restrict values = req.data();
+                for (int j = 0; j < width(); ++j) {
+                    allocationRow[j] = (T)(allocationRow[j] + values[j]);
+                    availableRow[j] = (T)(availableRow[j] - values[j]);
+                    needRow[j] = (T)(needRow[j] - values[j]);
+                }
+                return;
+            }
+            addInts(rowOf(allocation, pid), req.data());
+            subtractInts(available.data(), req.data());
+            subtractInts(rowOf(need, pid), req.data());
+        }
+
+        // Check if a release is valid: 0 <= rel <= allocation
+        bool canRelease(int pid, const std::vector<int>& rel) const {
+            if (pid < 0 || pid >= numProcesses) return false;
+            for (int j = 0; j < numResources; ++j) if (rel[j] < 0) return false;
+            return intsFit(rel.data(), rowOf(allocation, pid));
+        }
+
+        // Why canRelease() rejects rel: the first negative count, else the first resource over the
+        // allocation (resource gets its index)
+        DenialReason checkRelease(int pid, const std::vector<int>& rel, int& resource) const {
+            resource = -1;
+            if (pid < 0 || pid >= numProcesses) return DenialReason::UnknownProcess;
+            const T* allocationRow = rowOf(allocation, pid);
+            for (int j = 0; j < numResources; ++j) {
+                if (rel[j] < 0) { resource = j; return DenialReason::NegativeCount; }
+            }
+            for (int j = 0; j < numResources; ++j) {
+                if (rel[j] > allocationRow[j]) { resource = j; return DenialReason::ExceedsAllocation; }
+            }
+            return DenialReason::None;
+        }
+
+        // Return part of a process's allocation to Available; its need grows by the same amount.
+        // A release can never turn a safe state unsafe. Returns false (and changes nothing) if invalid.
+        bool release(int pid, const std::vector<int>& rel) {
+            if (!canRelease(pid, rel)) return false;
+            logRows(pid);
+            if (safeSequence.isValid()) {
+                deltaScratch.resize(numResources);
+                for (int j = 0; j < numResources; ++j) deltaScratch[j] = -rel[j];
+                safeSequence.noteChange(pid, deltaScratch.data(), nullptr);
+            }
+            subtractInts(rowOf(allocation, pid), rel.data());
+            addInts(available.data(), rel.data());
+            addInts(rowOf(need, pid), rel.data());
+            return true;
+        }
+
+        // A process has completed: its whole allocation returns to Available and its Max and Need
+        // drop to zero, so it no longer takes part in safety checks. Not logged for rollback, so it is
+        // refused inside a transaction. Returns false (and changes nothing) for an unknown pid or an open
+        // transaction.
+        bool finish(int pid) {
+            if (pid < 0 || pid >= numProcesses || inTransaction) return false;
+            if (safeSequence.isValid()) {
+                deltaScratch.resize(2 * (size_t)numResources);
+                for (int j = 0; j < numResources; ++j) {
+                    deltaScratch[j] = -(int)allocation(pid, j);
+                    deltaScratch[numResources + j] = -(int)need(pid, j);
+                }
+                safeSequence.noteChange(pid, deltaScratch.data(), deltaScratch.data() + numResources);
+            }
+            rowAdd(available.data(), rowOf(allocation, pid));
+            std::fill(allocation.row(pid), allocation.row(pid) + numResources, 0);
+            std::fill(max.row(pid), max.row(pid) + numResources, 0);
+            std::fill(need.row(pid), need.row(pid) + numResources, 0);
+            return true;
+        }
+
+        // Start logging applyRequest()/release() calls so they can be rolled back. Transactions don't nest.
+        void beginTransaction() {
+            undoPids.clear();
+            undoRows.clear();
+            undoAvailable.assign(available.begin(), available.end());
+            inTransaction = true;
+        }
+
+        // Validate and unpack a snapshot image held in memory
+        static bool loadSnapshotBytes(const char* data, size_t size, BasicBankersAlgorithm& out,
+                                      std::string& error) {
+            static_assert(std::is_same<T, int>::value, "snapshots hold int32 counts");
+            snapshot::Header header;
+            if (size < sizeof(header)) { error = "file too small for a snapshot"; return false; }
+            memcpy(&header, data, sizeof(header));
+            if (memcmp(header.magic, snapshot::kMagic, sizeof(header.magic)) != 0) { error = "not a snapshot file"; return false; }
+            if (header.byteOrder != snapshot::kByteOrderMark) { error = "snapshot has foreign byte order"; return false; }
+            if (header.version != snapshot::kVersion) { error = "unsupported snapshot version " + std::to_string(header.version); return false; }
+            if (header.headerSize != sizeof(header)) { error = "unexpected header size"; return false; }
+            if (header.headerChecksum != snapshot::headerChecksum(header)) { error = "header checksum mismatch"; return false; }
+            if (header.numResources > 0x7fffffffu || header.numProcesses > 0x7fffffffu) { error = "invalid dimensions"; return false; }
+            if (Width > 0 && header.numResources != (uint32_t)Width) { error = "snapshot has a different resource count"; return false; }
+
+            // Both dimensions are below 2^31, so cells < 2^62 and values < 2^64; only the byte count can overflow
+            uint64_t cells = (uint64_t)header.numProcesses * header.numResources;
+            uint64_t values = header.numResources + 3 * cells;
+            if (values > (UINT64_MAX - sizeof(header)) / sizeof(int) || sizeof(header) + values * sizeof(int) != size) {
+                error = "file size does not match its dimensions";
+                return false;
+            }
+
+            BasicBankersAlgorithm loaded((int)header.numProcesses, (int)header.numResources);
+            int* sections[4] = { loaded.available.data(), loaded.max.raw(), loaded.allocation.raw(), loaded.need.raw() };
+            const size_t sizes[4] = { header.numResources * sizeof(int), cells * sizeof(int),
+                                      cells * sizeof(int), cells * sizeof(int) };
+            const char* p = data + sizeof(header);
+            uint64_t sum = 0;
+            for (int k = 0; k < 4; ++k) {
+                sum = snapshot::checksum(p, sizes[k], sum);
+                memcpy(sections[k], p, sizes[k]);
+                p += sizes[k];
+            }
+            if (sum != header.payloadChecksum) { error = "payload checksum mismatch"; return false; }
+
+            out = std::move(loaded);
+            return true;
+        }
+
+        // Save pid's Allocation and Need rows before they are modified inside a transaction
+        void logRows(int pid) {
+            if (!inTransaction) return;
+            undoPids.push_back(pid);
+            undoRows.insert(undoRows.end(), allocation.row(pid), allocation.row(pid) + numResources);
+            undoRows.insert(undoRows.end(), need.row(pid), need.row(pid) + numResources);
+        }
+
+        // Keep everything applied since beginTransaction()
+        void commit() {
+            inTransaction = false;
+        }
+
+        // Undo everything applied since beginTransaction(), restoring only the logged rows
+        void rollback() {
+            if (!inTransaction) return;
+            for (size_t k = undoPids.size(); k-- > 0; ) {
+                const T* saved = undoRows.data() + k * 2 * (size_t)numResources;
+                if (safeSequence.isValid()) {
+                    deltaScratch.resize(2 * (size_t)numResources);
+                    for (int j = 0; j < numResources; ++j) {
+                        deltaScratch[j] = (int)((int64_t)saved[j] - allocation(undoPids[k], j));
+                        deltaScratch[numResources + j] = (int)((int64_t)saved[numResources + j] - need(undoPids[k], j));
+                    }
+                    safeSequence.noteChange(undoPids[k], deltaScratch.data(), deltaScratch.data() + numResources);
+                }
+                std::copy(saved, saved + numResources, allocation.row(undoPids[k]));
+                std::copy(saved + numResources, saved + 2 * numResources, need.row(undoPids[k]));
+            }
+            std::copy(undoAvailable.begin(), undoAvailable.end(), available.begin());
+            inTransaction = false;
+        }
+
+        // Print just the need matrix with a header (used for 'New Need')
+        void printNeedWithHeader(const std::string& header, std::ostream& os) const {
+            RowWriter out(os);
+            out.line(header);
+            out.rows(need.raw(), numProcesses, numResources);
+        }
+
+        // Print current state (for verification)
+        void printState(std::ostream& os) const {
+            RowWriter out(os);
+            out.text("Resources: ");
+            out.integer(numResources);
+            out.text(", Processes: ");
+            out.integer(numProcesses);
+            out.put('\n');
+            out.line("Available");
+            out.rows(available.data(), 1, numResources);
+            out.line("Max");
+            out.rows(max.raw(), numProcesses, numResources);
+            out.line("Allocation");
+            out.rows(allocation.raw(), numProcesses, numResources);
+            out.line("Need");
+            out.rows(need.raw(), numProcesses, numResources);
+        }
+};
+
+typedef BasicBankersAlgorithm<0> BankersAlgorithm;
+
+// State specialized for exactly R resources. processInput() is instantiated for these and for
+// BankersAlgorithm; main() moves a loaded state into one when its resource count is 3, 4, 8 or 16.
+template <int R, class T = int>
+using FixedBankersAlgorithm = BasicBankersAlgorithm<R, T>;
+
+// Banker's algorithm state with the Max, Allocation and Need rows stored CSR-style: for each process
+// only the resources in the union of its Max and Allocation nonzeros, which is fixed for the life
+// of the state (a request never exceeds Need and a release never exceeds Allocation, so nothing
+// outside it can become nonzero). The safety engines, computeNeed(), requests and releases touch
+// only those entries, so time and memory follow the number of nonzeros rather than P x R; Work and
+// Available stay dense. Chosen by main() for mostly-zero inputs without negative counts.
+//
+// Engines give the same verdicts and safe sequences as BasicBankersAlgorithm's: the sweep and the
+// worklist visit processes and resources in the same order, and the parallel engine's rounds are
+// run on the calling thread. In incremental mode the last safe sequence is replayed, in O(nonzeros),
+// before falling back to the engine.
+template <class T>
+class SparseBankersAlgorithm {
+    private:
+        int numProcesses;                // Number of processes
+        int numResources;                // Number of resources
+        std::vector<size_t> rowStart;    // entries of process i are [rowStart[i], rowStart[i + 1])
+        std::vector<int> column;         // resource of each entry, ascending within a row
+        std::vector<T> maxValues;        // Max, Allocation and Need of each entry
+        std::vector<T> allocationValues;
+        std::vector<T> needValues;
+        std::vector<T> available;        // Available resources (dense)
+        SafetyEngine engine = SafetyEngine::Sweep;
+        mutable std::vector<EngineDisagreement> disagreements;  // CrossCheck mismatches not yet taken
+
+        bool incremental = false;
+        mutable std::vector<int> cachedSequence;    // last safe sequence found, replayed first (incremental mode)
+
+        // Undo log, as in BasicBankersAlgorithm: each logged process's Allocation and Need entries
+        bool inTransaction = false;
+        std::vector<int> undoPids;
+        std::vector<T> undoValues;
+        std::vector<T> undoAvailable;
+
+        // Rows of the current state
+        struct CurrentRows {
+            const SparseBankersAlgorithm& state;
+            explicit CurrentRows(const SparseBankersAlgorithm& s) : state(s) {}
+            const T* need(int i) const { return state.needValues.data() + state.rowStart[i]; }
+            const T* allocation(int i) const { return state.allocationValues.data() + state.rowStart[i]; }
+        };
+
+        // Rows of the current state with one process's entries replaced
+        struct AdjustedRows {
+            const SparseBankersAlgorithm& state;
+            int pid;
+            const T* needRow;
+            const T* allocationRow;
+            AdjustedRows(const SparseBankersAlgorithm& s, int p, const T* n, const T* a)
+                : state(s), pid(p), needRow(n), allocationRow(a) {}
+            const T* need(int i) const { return i == pid ? needRow : state.needValues.data() + state.rowStart[i]; }
+            const T* allocation(int i) const {
+                return i == pid ? allocationRow : state.allocationValues.data() + state.rowStart[i];
+            }
+        };
+
+        // Entries of process i, and their resources
+        size_t entries(int i) const { return rowStart[i + 1] - rowStart[i]; }
+        const int* columns(int i) const { return column.data() + rowStart[i]; }
+
+        template <class Rows>
+        bool fits(const Rows& rows, int i, const std::vector<T>& work) const {
+            const int* cols = columns(i);
+            const T* needRow = rows.need(i);
+            for (size_t k = 0, n = entries(i); k < n; ++k) if (needRow[k] > work[cols[k]]) return false;
+            return true;
+        }
+
+        template <class Rows>
+        void returnAllocation(const Rows& rows, int i, std::vector<T>& work) const {
+            const int* cols = columns(i);
+            const T* allocationRow = rows.allocation(i);
+            for (size_t k = 0, n = entries(i); k < n; ++k) work[cols[k]] = (T)(work[cols[k]] + allocationRow[k]);
+        }
+
+        // The sweep over a stably compacted list of unfinished processes, as in BasicBankersAlgorithm
+        bool isSafeSweep(std::vector<int>* order, std::vector<T>* trace) const {
+            std::vector<T> work = available;
+            std::vector<int> live(numProcesses);
+            for (int i = 0; i < numProcesses; ++i) live[i] = i;
+            if (order) order->clear();
+            if (trace) trace->clear();
+            CurrentRows rows(*this);
+
+            while (!live.empty()) {
+                size_t kept = 0;
+                for (int i : live) {
+                    if (!fits(rows, i, work)) {
+                        live[kept++] = i;
+                        continue;
+                    }
+                    returnAllocation(rows, i, work);
+                    if (order) order->push_back(i);
+                    if (trace) trace->insert(trace->end(), work.begin(), work.end());
+                }
+                if (kept == live.size()) break;     // no progress
+                live.resize(kept);
+            }
+
+            return live.empty();
+        }
+
+        // The worklist algorithm of BasicBankersAlgorithm::worklistSafety() with a cursor over each
+        // process's entries instead of over all resources
+        template <class Rows>
+        bool worklistSafety(const Rows& rows, const T* availableRow, std::vector<int>* order,
+                            std::vector<T>* trace) const {
+            typedef std::pair<T, int> Waiter;                          // (need on the blocking resource, pid)
+            std::vector<T> work(availableRow, availableRow + numResources);
+            std::vector<size_t> cursor(numProcesses, 0);               // first entry not yet known satisfied
+            std::vector<std::vector<Waiter>> blocked(numResources);    // min-heaps of waiters per resource
+            std::vector<int> ready;
+            ready.reserve(numProcesses);
+
+            auto examine = [&](int pid) {
+                const int* cols = columns(pid);
+                const T* needRow = rows.need(pid);
+                size_t k = cursor[pid];
+                size_t n = entries(pid);
+                while (k < n && needRow[k] <= work[cols[k]]) ++k;
+                cursor[pid] = k;
+                if (k == n) {
+                    ready.push_back(pid);
+                } else {
+                    std::vector<Waiter>& heap = blocked[cols[k]];
+                    heap.push_back(Waiter(needRow[k], pid));
+                    std::push_heap(heap.begin(), heap.end(), std::greater<Waiter>());
+                }
+            };
+
+            for (int i = 0; i < numProcesses; ++i) examine(i);
+
+            int finished = 0;
+            if (order) order->clear();
+            if (trace) trace->clear();
+            while (!ready.empty()) {
+                int i = ready.back();
+                ready.pop_back();
+                ++finished;
+                if (order) order->push_back(i);
+
+                returnAllocation(rows, i, work);
+                if (trace) trace->insert(trace->end(), work.begin(), work.end());
+                const int* cols = columns(i);
+                const T* allocationRow = rows.allocation(i);
+                for (size_t k = 0, n = entries(i); k < n; ++k) {
+                    if (allocationRow[k] == 0) continue;
+                    std::vector<Waiter>& heap = blocked[cols[k]];
+                    while (!heap.empty() && heap.front().first <= work[cols[k]]) {
+                        std::pop_heap(heap.begin(), heap.end(), std::greater<Waiter>());
+                        int waiter = heap.back().second;
+                        heap.pop_back();
+                        examine(waiter);
+                    }
+                }
+            }
+
+            return finished == numProcesses;
+        }
+
+        // The parallel engine's rounds: every unfinished process is tested against the Work of the
+        // round's start, and the runnable ones finish together in pid order
+        bool isSafeRounds(std::vector<int>* order, std::vector<T>* trace) const {
+            std::vector<T> work = available, roundWork;
+            std::vector<int> live(numProcesses), runnable;
+            for (int i = 0; i < numProcesses; ++i) live[i] = i;
+            if (order) order->clear();
+            if (trace) trace->clear();
+            CurrentRows rows(*this);
+
+            while (!live.empty()) {
+                roundWork = work;
+                runnable.clear();
+                size_t kept = 0;
+                for (int i : live) {
+                    if (fits(rows, i, roundWork)) runnable.push_back(i);
+                    else live[kept++] = i;
+                }
+                if (runnable.empty()) break;
+                live.resize(kept);
+                for (int i : runnable) {
+                    returnAllocation(rows, i, work);
+                    if (order) order->push_back(i);
+                    if (trace) trace->insert(trace->end(), work.begin(), work.end());
+                }
+            }
+
+            return live.empty();
+        }
+
+        bool runEngine(std::vector<int>* order, std::vector<T>* trace) const {
+            switch (engine) {
+                case SafetyEngine::Worklist:
+                    return worklistSafety(CurrentRows(*this), available.data(), order, trace);
+                case SafetyEngine::Parallel:
+                    return isSafeRounds(order, trace);
+                case SafetyEngine::CrossCheck: {
+                    bool sweep = isSafeSweep(order, trace);
+                    bool worklist = worklistSafety(CurrentRows(*this), available.data(), nullptr, nullptr);
+                    bool parallel = isSafeRounds(nullptr, nullptr);
+                    if (sweep != worklist || sweep != parallel) {
+                        disagreements.push_back(EngineDisagreement{ sweep, worklist, parallel });
+                    }
+                    return sweep;
+                }
+                case SafetyEngine::Sweep:
+                default:
+                    return isSafeSweep(order, trace);
+            }
+        }
+
+        // True if the cached sequence is complete and still lets every process finish in turn
+        bool cachedSequenceHolds() const {
+            if ((int)cachedSequence.size() != numProcesses) return false;
+            std::vector<T> work = available;
+            CurrentRows rows(*this);
+            for (int i : cachedSequence) {
+                if (!fits(rows, i, work)) return false;
+                returnAllocation(rows, i, work);
+            }
+            return true;
+        }
+
+        // Save pid's Allocation and Need entries before they are modified inside a transaction
+        void logRows(int pid) {
+            if (!inTransaction) return;
+            undoPids.push_back(pid);
+            size_t first = rowStart[pid], last = rowStart[pid + 1];
+            undoValues.insert(undoValues.end(), allocationValues.begin() + first, allocationValues.begin() + last);
+            undoValues.insert(undoValues.end(), needValues.begin() + first, needValues.begin() + last);
+        }
+
+        // Check that 0 <= values <= limit, where limit holds pid's entries (zero elsewhere) and
+        // values a dense row, optionally also values <= Available
+        bool withinEntries(int pid, const std::vector<int>& values, const T* limit, bool againstAvailable) const {
+            const int* cols = columns(pid);
+            size_t k = 0, n = entries(pid);
+            for (int j = 0; j < numResources; ++j) {
+                int64_t bound = 0;
+                if (k < n && cols[k] == j) bound = limit[k++];
+                if (values[j] < 0 || values[j] > bound) return false;
+                if (againstAvailable && values[j] > available[j]) return false;
+            }
+            return true;
+        }
+    public:
+        typedef T Value;
+
+        // Build from a dense state as parsed (every count nonnegative and fitting in T)
+        static SparseBankersAlgorithm fromDense(BankersAlgorithm&& dense) {
+            SparseBankersAlgorithm out;
+            int P = dense.processCount();
+            int R = dense.resourceCount();
+            out.numProcesses = P;
+            out.numResources = R;
+            const int* maxData = dense.maxData();
+            const int* allocationData = dense.allocationData();
+            out.available.assign(dense.availableData(), dense.availableData() + R);
+            out.rowStart.assign(1, 0);
+            out.rowStart.reserve((size_t)P + 1);
+            for (int i = 0; i < P; ++i) {
+                const int* maxRow = maxData + (size_t)i * R;
+                const int* allocationRow = allocationData + (size_t)i * R;
+                for (int j = 0; j < R; ++j) {
+                    if (maxRow[j] == 0 && allocationRow[j] == 0) continue;
+                    out.column.push_back(j);
+                    out.maxValues.push_back((T)maxRow[j]);
+                    out.allocationValues.push_back((T)allocationRow[j]);
+                }
+                out.rowStart.push_back(out.column.size());
+            }
+            out.needValues.resize(out.column.size());
+            out.computeNeed();
+            dense = BankersAlgorithm(0, 0);
+            return out;
+        }
+
+        int processCount() const { return numProcesses; }
+        int resourceCount() const { return numResources; }
+        size_t nonzeros() const { return column.size(); }
+
+        // Compute need = max - allocation over the stored entries
+        void computeNeed() {
+            for (size_t k = 0; k < needValues.size(); ++k) {
+                needValues[k] = maxValues[k] > allocationValues[k] ? (T)(maxValues[k] - allocationValues[k]) : 0;
+            }
+        }
+
+        void setEngine(SafetyEngine e) { engine = e; }
+
+        // Move the mismatches the CrossCheck engine found since the last call into found, oldest first
+        void takeEngineDisagreements(std::vector<EngineDisagreement>& found) {
+            found.swap(disagreements);
+            disagreements.clear();
+        }
+
+        // The engines run on the calling thread
+        void setThreads(int) {}
+
+        void setIncremental(bool on) {
+            incremental = on;
+            cachedSequence.clear();
+        }
+
+        bool isSafe() const {
+            if (!incremental) return runEngine(nullptr, nullptr);
+            if (cachedSequenceHolds()) return true;
+            std::vector<int> order;
+            if (!runEngine(&order, nullptr)) return false;
+            cachedSequence = order;
+            return true;
+        }
+
+        bool isSafe(std::vector<int>& sequence, std::vector<T>* workTrace = nullptr) const {
+            if (incremental && cachedSequenceHolds()) {
+                sequence = cachedSequence;
+                if (workTrace) {
+                    workTrace->clear();
+                    std::vector<T> work = available;
+                    for (int pid : sequence) {
+                        returnAllocation(CurrentRows(*this), pid, work);
+                        workTrace->insert(workTrace->end(), work.begin(), work.end());
+                    }
+                }
+                return true;
+            }
+            bool safe = runEngine(&sequence, workTrace);
+            if (incremental && safe) cachedSequence = sequence;
+            return safe;
+        }
+
+        // What-if check: would granting req to pid leave the system safe? Thread-safe like
+        // BasicBankersAlgorithm::isSafeAfter(); assumes canRequest() passed.
+        bool isSafeAfter(int pid, const std::vector<int>& req, std::vector<T>& scratch) const {
+            size_t n = entries(pid);
+            scratch.resize((size_t)numResources + 2 * n);
+            T* adjustedAvailable = scratch.data();
+            T* adjustedNeed = adjustedAvailable + numResources;
+            T* adjustedAllocation = adjustedNeed + n;
+            std::copy(available.begin(), available.end(), adjustedAvailable);
+            const int* cols = columns(pid);
+            for (size_t k = 0; k < n; ++k) {
+                int v = req[cols[k]];
+                adjustedAvailable[cols[k]] = (T)(adjustedAvailable[cols[k]] - v);
+                adjustedNeed[k] = (T)(needValues[rowStart[pid] + k] - v);
+                adjustedAllocation[k] = (T)(allocationValues[rowStart[pid] + k] + v);
+            }
+            return worklistSafety(AdjustedRows(*this, pid, adjustedNeed, adjustedAllocation),
+                                  adjustedAvailable, nullptr, nullptr);
+        }
+
+        // Check if a request can be considered: 0 <= req <= need and req <= available
+        bool canRequest(int pid, const std::vector<int>& req) const {
+            if (pid < 0 || pid >= numProcesses) return false;
+            return withinEntries(pid, req, needValues.data() + rowStart[pid], true);
+        }
+
+        // Why canRequest() rejects req, as BasicBankersAlgorithm::checkRequest() reports it
+        DenialReason checkRequest(int pid, const std::vector<int>& req, int& resource) const {
+            resource = -1;
+            if (pid < 0 || pid >= numProcesses) return DenialReason::UnknownProcess;
+            for (int j = 0; j < numResources; ++j) {
+                if (req[j] < 0) { resource = j; return DenialReason::NegativeCount; }
+            }
+            const int* cols = columns(pid);
+            const T* needRow = needValues.data() + rowStart[pid];
+            size_t k = 0, n = entries(pid);
+            for (int j = 0; j < numResources; ++j) {
+                int64_t bound = 0;
+                if (k < n && cols[k] == j) bound = needRow[k++];
+                if (req[j] > bound) { resource = j; return DenialReason::ExceedsNeed; }
+            }
+            for (int j = 0; j < numResources; ++j) {
+                if (req[j] > available[j]) { resource = j; return DenialReason::ExceedsAvailable; }
+            }
+            return DenialReason::None;
+        }
+
+        // Apply the request (assumes it's valid, see canRequest); it is zero outside pid's entries
+        void applyRequest(int pid, const std::vector<int>& req) {
+            if (pid < 0 || pid >= numProcesses) return;
+            logRows(pid);
+            const int* cols = columns(pid);
+            for (size_t k = 0, n = entries(pid), at = rowStart[pid]; k < n; ++k, ++at) {
+                int v = req[cols[k]];
+                allocationValues[at] = (T)(allocationValues[at] + v);
+                needValues[at] = (T)(needValues[at] - v);
+                available[cols[k]] = (T)(available[cols[k]] - v);
+            }
+        }
+
+        // Check if a release is valid: 0 <= rel <= allocation
+        bool canRelease(int pid, const std::vector<int>& rel) const {
+            if (pid < 0 || pid >= numProcesses) return false;
+            return withinEntries(pid, rel, allocationValues.data() + rowStart[pid], false);
+        }
+
+        // Why canRelease() rejects rel, as BasicBankersAlgorithm::checkRelease() reports it
+        DenialReason checkRelease(int pid, const std::vector<int>& rel, int& resource) const {
+            resource = -1;
+            if (pid < 0 || pid >= numProcesses) return DenialReason::UnknownProcess;
+            for (int j = 0; j < numResources; ++j) {
+                if (rel[j] < 0) { resource = j; return DenialReason::NegativeCount; }
+            }
+            const int* cols = columns(pid);
+            const T* allocationRow = allocationValues.data() + rowStart[pid];
+            size_t k = 0, n = entries(pid);
+            for (int j = 0; j < numResources; ++j) {
+                int64_t bound = 0;
+                if (k < n && cols[k] == j) bound = allocationRow[k++];
+                if (rel[j] > bound) { resource = j; return DenialReason::ExceedsAllocation; }
+            }
+            return DenialReason::None;
+        }
+
+        // Return part of a process's allocation to Available; its need grows by the same amount
+        bool release(int pid, const std::vector<int>& rel) {
+            if (!canRelease(pid, rel)) return false;
+            logRows(pid);
+            const int* cols = columns(pid);
+            for (size_t k = 0, n = entries(pid), at = rowStart[pid]; k < n; ++k, ++at) {
+                int v = rel[cols[k]];
+                allocationValues[at] = (T)(allocationValues[at] - v);
+                needValues[at] = (T)(needValues[at] + v);
+                available[cols[k]] = (T)(available[cols[k]] + v);
+            }
+            return true;
+        }
+
+        // A process has completed: its allocation returns to Available and its entries drop to zero.
+        // Not logged for rollback, so refused inside a transaction like BasicBankersAlgorithm::finish().
+        bool finish(int pid) {
+            if (pid < 0 || pid >= numProcesses || inTransaction) return false;
+            const int* cols = columns(pid);
+            for (size_t k = 0, n = entries(pid), at = rowStart[pid]; k < n; ++k, ++at) {
+                available[cols[k]] = (T)(available[cols[k]] + allocationValues[at]);
+                allocationValues[at] = maxValues[at] = needValues[at] = 0;
+            }
+            return true;
+        }
+
+        void beginTransaction() {
+            undoPids.clear();
+            undoValues.clear();
+            undoAvailable.assign(available.begin(), available.end());
+            inTransaction = true;
+        }
+
+        void commit() {
+            inTransaction = false;
+        }
+
+        void rollback() {
+            if (!inTransaction) return;
+            size_t end = undoValues.size();
+            for (size_t k = undoPids.size(); k-- > 0; ) {
+                int pid = undoPids[k];
+                size_t first = rowStart[pid], n = entries(pid);
+                end -= 2 * n;
+                const T* saved = undoValues.data() + end;
+                std::copy(saved, saved + n, allocationValues.begin() + first);
+                std::copy(saved + n, saved + 2 * n, needValues.begin() + first);
+            }
+            std::copy(undoAvailable.begin(), undoAvailable.end(), available.begin());
+            inTransaction = false;
+        }
+
+        // Print the need matrix in full, zeros included (used for 'New Need')
+        void printNeedWithHeader(const std::string& header, std::ostream& os) const {
+            RowWriter out(os);
+            out.line(header);
+            std::vector<T> row(numResources);
+            for (int i = 0; i < numProcesses; ++i) {
+                std::fill(row.begin(), row.end(), 0);
+                const int* cols = columns(i);
+                const T* needRow = needValues.data() + rowStart[i];
+                for (size_t k = 0, n = entries(i); k < n; ++k) row[cols[k]] = needRow[k];
+                out.rows(row.data(), 1, numResources);
+            }
+        }
+};
+
+// Parse a process name like "P1" into its index, or -1 if it isn't one
+inline int parseProcessId(const std::string& procName) {
+    int pid = -1;
+    if (!procName.empty() && (procName[0] == 'P' || procName[0] == 'p')) {
+        try { pid = std::stoi(procName.substr(1)); } catch(...) { pid = -1; }
+    }
+    return pid;
+}
+
+// Read count integers into dst; on failure error says which section was being read and where
+inline bool readInts(InputScanner& in, int* dst, size_t count, const char* section, std::string& error) {
+    for (size_t k = 0; k < count; ++k) {
+        if (in.nextInt(dst[k])) continue;
+        if (in.atEnd()) error = std::string("Unexpected EOF reading ") + section;
+        else error = std::string("Expected integer in ") + section + " but found '" + in.lastToken() + "' at " + in.location();
+        return false;
+    }
+    return true;
+}
+
+// Parse the textual R/P/Available/Max/Allocation state. Integers are scanned straight into the
+// matrix storage. Empty input leaves an empty 0 x 0 state. On failure error describes the problem.
+inline bool parseState(InputScanner& in, BankersAlgorithm& bankers, std::string& error) {
+    std::string_view token;
+    int numResources = 0;
+    int numProcesses = 0;
+
+    if (!in.nextToken(token)) { bankers = BankersAlgorithm(0, 0); return true; }
+    if (token == "R" || token == "r") {
+        if (!in.nextInt(numResources) || numResources < 0) {
+            error = "Expected number of resources but found '" + in.lastToken() + "' at " + in.location();
+            return false;
+        }
+    } else {
+        error = "Expected 'R' at start";
+        return false;
+    }
+
+    if (!in.nextToken(token)) { error = "Expected 'P' after resources"; return false; }
+    if (token == "P") {
+        if (!in.nextInt(numProcesses) || numProcesses < 0) {
+            error = "Expected number of processes but found '" + in.lastToken() + "' at " + in.location();
+            return false;
+        }
+    } else {
+        error = "Expected 'P' token at " + in.location();
+        return false;
+    }
+
+    // Create the Banker's Algorithm instance with the parsed number of processes and resources
+    bankers = BankersAlgorithm(numProcesses, numResources);
+
+    // Available
+    if (!in.nextToken(token)) { error = "Unexpected EOF reading Available"; return false; }
+    if (token != "Available") {
+        error = "Expected 'Available' but found '" + std::string(token) + "' at " + in.location();
+        return false;
+    }
+    if (!readInts(in, bankers.availableData(), numResources, "Available", error)) return false;
+
+    // Max
+    if (!in.nextToken(token)) { error = "Unexpected EOF reading Max"; return false; }
+    if (token != "Max") { error = "Expected 'Max' but found '" + std::string(token) + "' at " + in.location(); return false; }
+    if (!readInts(in, bankers.maxData(), (size_t)numProcesses * numResources, "Max", error)) return false;
+
+    // Allocation
+    if (!in.nextToken(token)) { error = "Unexpected EOF reading Allocation"; return false; }
+    if (token != "Allocation") {
+        error = "Expected 'Allocation' but found '" + std::string(token) + "' at " + in.location();
+        return false;
+    }
+    if (!readInts(in, bankers.allocationData(), (size_t)numProcesses * numResources, "Allocation", error)) return false;
+
+    // Compute need for the current state
+    bankers.computeNeed();
+    return true;
+}
+
+// Element types a parsed state can be converted to, narrowest first
+enum class ElementType { UInt8, UInt16, Int32, Int64 };
+
+// Narrowest element type that holds every value the state can reach. Grants, releases and finishes
+// only move units between Available and Allocation, so no count (Work included) ever exceeds the
+// larger of the largest Max entry and Available[j] plus column j of Allocation. Negative inputs
+// keep a signed type.
+inline ElementType elementTypeFor(const BankersAlgorithm& state) {
+    int numProcesses = state.processCount();
+    int numResources = state.resourceCount();
+    const int* available = state.availableData();
+    const int* maxData = state.maxData();
+    const int* allocationData = state.allocationData();
+    std::vector<int64_t> total(available, available + numResources);
+    int64_t bound = 0;
+    bool negative = false;
+    for (int j = 0; j < numResources; ++j) negative |= available[j] < 0;
+    for (int i = 0; i < numProcesses; ++i) {
+        const int* maxRow = maxData + (size_t)i * numResources;
+        const int* allocationRow = allocationData + (size_t)i * numResources;
+        for (int j = 0; j < numResources; ++j) {
+            total[j] += allocationRow[j];
+            bound = std::max<int64_t>(bound, maxRow[j]);
+            negative |= (maxRow[j] | allocationRow[j]) < 0;
+        }
+    }
+    for (int j = 0; j < numResources; ++j) bound = std::max(bound, total[j]);
+
+    if (bound > INT_MAX) return ElementType::Int64;
+    if (negative || bound > UINT16_MAX) return ElementType::Int32;
+    return bound > UINT8_MAX ? ElementType::UInt16 : ElementType::UInt8;
+}
+
+// Fraction of the Max/Allocation cells that are nonzero in either matrix
+inline double nonzeroDensity(const BankersAlgorithm& state) {
+    size_t cells = (size_t)state.processCount() * state.resourceCount();
+    if (cells == 0) return 1.0;
+    const int* maxData = state.maxData();
+    const int* allocationData = state.allocationData();
+    size_t nonzeros = 0;
+    for (size_t k = 0; k < cells; ++k) nonzeros += (maxData[k] | allocationData[k]) != 0;
+    return (double)nonzeros / (double)cells;
+}
+
+// True if any Available, Max or Allocation count is negative (the CSR backend can't hold those)
+inline bool hasNegativeCounts(const BankersAlgorithm& state) {
+    size_t cells = (size_t)state.processCount() * state.resourceCount();
+    const int* available = state.availableData();
+    const int* maxData = state.maxData();
+    const int* allocationData = state.allocationData();
+    for (int j = 0; j < state.resourceCount(); ++j) if (available[j] < 0) return true;
+    for (size_t k = 0; k < cells; ++k) if ((maxData[k] | allocationData[k]) < 0) return true;
+    return false;
+}
+
+// Lock-free ring buffers for handing work to the thread that owns the state.
+//
+// MpscRing is Dmitry Vyukov's bounded queue used with a single consumer: every cell carries a
+// sequence number that says whether it is free for the producer claiming position p (sequence
+// == p) or holds a value for the consumer at p (sequence == p + 1). Producers claim positions with
+// one CAS on the shared tail; the consumer owns the head outright. Values are written in place,
+// so cells that hold vectors keep their capacity and a steady stream allocates nothing.
+template <class T>
+class MpscRing {
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+        std::unique_ptr<Cell[]> cells;
+        size_t mask;
+        alignas(64) std::atomic<size_t> tail{0};    // next position to claim (producers)
+        alignas(64) size_t head = 0;                // next position to consume (consumer only)
+
+    public:
+        // capacity is rounded up to a power of two
+        explicit MpscRing(size_t capacity) {
+            size_t size = 2;
+            while (size < capacity) size *= 2;
+            cells.reset(new Cell[size]);
+            mask = size - 1;
+            for (size_t k = 0; k < size; ++k) cells[k].sequence.store(k, std::memory_order_relaxed);
+        }
+
+        // Claim a cell and let fill(T&) write it; false (nothing written) if the ring is full
+        template <class Fill>
+        bool tryPush(Fill fill) {
+            size_t position = tail.load(std::memory_order_relaxed);
+            Cell* cell;
+            while (true) {
+                cell = &cells[position & mask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+                if (diff == 0) {
+                    if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    position = tail.load(std::memory_order_relaxed);
+                }
+            }
+            fill(cell->value);
+            cell->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Hand the oldest value to take(T&); false if the ring is empty. Consumer thread only.
+        template <class Take>
+        bool tryPop(Take take) {
+            Cell& cell = cells[head & mask];
+            if (cell.sequence.load(std::memory_order_acquire) != head + 1) return false;
+            take(cell.value);
+            cell.sequence.store(head + mask + 1, std::memory_order_release);
+            ++head;
+            return true;
+        }
+};
+
+// Bounded single-producer single-consumer ring
+template <class T>
+class SpscRing {
+    private:
+        std::vector<T> slots;
+        size_t mask;
+        alignas(64) std::atomic<size_t> head{0};    // advanced by the consumer
+        alignas(64) std::atomic<size_t> tail{0};    // advanced by the producer
+
+    public:
+        explicit SpscRing(size_t capacity) {
+            size_t size = 2;
+            while (size < capacity) size *= 2;
+            slots.resize(size);
+            mask = size - 1;
+        }
+
+        size_t capacity() const { return slots.size(); }
+
+        bool tryPush(const T& value) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == slots.size()) return false;
+            slots[t & mask] = value;
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool tryPop(T& value) {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire)) return false;
+            value = slots[h & mask];
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+};
+
+// Outcome of a request
+enum class Decision : char {
+    Granted,            // applied; the system stays safe
+    Invalid,            // unknown process, wrong length, or exceeds need or available
+    Unsafe,             // would leave the system unsafe; not applied
+    SystemUnsafe        // the system was already unsafe; nothing is granted
+};
+
+// What decideRequest() found
+struct RequestResult {
+    Decision decision = Decision::Invalid;
+    DenialReason reason = DenialReason::None;   // why an Invalid request failed canRequest()
+    int resource = -1;                          // the resource it failed on, if any
+    std::vector<int> safeSequence;   // a safe sequence of the new state, if granted and asked for
+
+    bool granted() const { return decision == Decision::Granted; }
+};
+
+// Decide one request against the state the way the resource-request algorithm does: a granted
+// request stays applied, any other leaves the state unchanged. With withSequence, a granted
+// result carries a safe sequence of the new state, and workTrace (if given) the Work vector after
+// each process in it finishes. A request without exactly one count per resource is Invalid
+// (WrongLength) before anything reads it. onApplied() runs once the request is tentatively
+// applied, before the safety check, e.g. to print the new Need matrix.
+template <class Bankers, class OnApplied>
+RequestResult decideRequest(Bankers& bankers, int pid, const std::vector<int>& request, bool systemSafe,
+                            bool withSequence, std::vector<typename Bankers::Value>* workTrace,
+                            OnApplied&& onApplied) {
+    RequestResult result;
+    if (!systemSafe) {
+        result.decision = Decision::SystemUnsafe;
+        return result;
+    }
+    if (request.size() != (size_t)bankers.resourceCount()) {
+        result.decision = Decision::Invalid;
+        result.reason = DenialReason::WrongLength;
+        return result;
+    }
+    if (!bankers.canRequest(pid, request)) {
+        result.decision = Decision::Invalid;
+        result.reason = bankers.checkRequest(pid, request, result.resource);
+        return result;
+    }
+    bankers.beginTransaction();
+    bankers.applyRequest(pid, request);
+    onApplied();
+    bool safe = withSequence ? bankers.isSafe(result.safeSequence, workTrace) : bankers.isSafe();
+    if (safe) {
+        bankers.commit();
+        result.decision = Decision::Granted;
+    } else {
+        bankers.rollback();
+        result.decision = Decision::Unsafe;
+        result.safeSequence.clear();
+    }
+    return result;
+}
+
+template <class Bankers>
+RequestResult decideRequest(Bankers& bankers, int pid, const std::vector<int>& request, bool systemSafe,
+                            bool withSequence = false) {
+    return decideRequest(bankers, pid, request, systemSafe, withSequence, nullptr, [] {});
+}
+
+// In-process request ingest: any number of producer threads submit requests through one MPSC
+// ring to the thread that owns the state, which decides them in arrival order (canRequest,
+// applyRequest, isSafe) and returns each verdict on the submitting producer's own SPSC ring. No
+// step takes a lock. A producer may have at most replyCapacity requests outstanding, so the owner
+// never finds a reply ring full.
+//
+// Register every producer before any thread starts submitting; each Producer is then used by one
+// thread only, and drain()/run() by the owner only.
+template <class Bankers>
+class RequestIngest {
+    public:
+        struct Reply {
+            uint64_t ticket;
+            Decision decision;
+            DenialReason reason;         // for Invalid requests, see RequestResult
+            int resource;
+        };
+
+        class Producer {
+            private:
+                friend class RequestIngest;
+                RequestIngest& ingest;
+                int index;
+                SpscRing<Reply> replies;
+                uint64_t submitted = 0;          // tickets handed out
+                uint64_t received = 0;           // replies taken
+
+                Producer(RequestIngest& owner, int id, size_t replyCapacity)
+                    : ingest(owner), index(id), replies(replyCapacity) {}
+
+            public:
+                // Queue a request for pid; its ticket (0, 1, 2, ... per producer) comes back with
+                // the reply. False if the ingest ring is full, too many replies are outstanding, or
+                // the request does not have one count per resource (it is never queued).
+                bool submit(int pid, const std::vector<int>& request, uint64_t& ticket) {
+                    if (request.size() != ingest.resourceCount) return false;
+                    if (submitted - received == replies.capacity()) return false;
+                    uint64_t next = submitted;
+                    bool pushed = ingest.queue.tryPush([&](Submission& cell) {
+                        cell.producer = index;
+                        cell.ticket = next;
+                        cell.pid = pid;
+                        cell.request.assign(request.begin(), request.end());
+                    });
+                    if (!pushed) return false;
+                    ticket = next;
+                    ++submitted;
+                    return true;
+                }
+
+                // Take the next decided request, if any (in the order the owner decided them)
+                bool poll(Reply& reply) {
+                    if (!replies.tryPop(reply)) return false;
+                    ++received;
+                    return true;
+                }
+
+                uint64_t outstanding() const { return submitted - received; }
+        };
+
+    private:
+        struct Submission {
+            int producer = 0;
+            uint64_t ticket = 0;
+            int pid = 0;
+            std::vector<int> request;
+        };
+
+        Bankers& bankers;
+        bool systemSafe;
+        size_t resourceCount;                // fixed for the state's lifetime; read by producers
+        size_t replyCapacity;
+        MpscRing<Submission> queue;
+        std::vector<std::unique_ptr<Producer>> producers;
+        std::vector<int> request;            // owner's copy of the request being decided
+
+    public:
+        RequestIngest(Bankers& state, size_t capacity = 4096, size_t repliesPerProducer = 1024)
+            : bankers(state), systemSafe(state.isSafe()), resourceCount((size_t)state.resourceCount()),
+              replyCapacity(repliesPerProducer), queue(capacity) {}
+
+        Producer& addProducer() {
+            producers.emplace_back(new Producer(*this, (int)producers.size(), replyCapacity));
+            return *producers.back();
+        }
+
+        // Decide up to limit queued requests; the number decided
+        size_t drain(size_t limit = SIZE_MAX) {
+            size_t decided = 0;
+            int producer = 0;
+            uint64_t ticket = 0;
+            int pid = 0;
+            while (decided < limit && queue.tryPop([&](Submission& cell) {
+                       producer = cell.producer;
+                       ticket = cell.ticket;
+                       pid = cell.pid;
+                       request.swap(cell.request);
+                   })) {
+                RequestResult result = decideRequest(bankers, pid, request, systemSafe);
+                producers[producer]->replies.tryPush(Reply{ ticket, result.decision, result.reason, result.resource });
+                ++decided;
+            }
+            return decided;
+        }
+
+        // Owner loop: drain until stop is set, yielding the CPU whenever the ring is empty
+        void run(const std::atomic<bool>& stop) {
+            while (!stop.load(std::memory_order_acquire)) {
+                if (drain(256) == 0) std::this_thread::yield();
+            }
+            drain();
+        }
+};
+
+}
+
+#endif
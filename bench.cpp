@@ -0,0 +1,326 @@
+#include "bankers.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <iomanip>
+#include <functional>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+using namespace bankers;
+
+/*
+    Microbenchmarks for the Banker's Algorithm library (bankers.h).
+
+    What this file does:
+    - Builds random safe, unsafe and worst-case-ordered states over a grid of P x R.
+    - Times computeNeed(), isSafe() with each engine, canRequest(), applyRequest() with rollback, the
+    incremental request cycle, the fixed-width and narrow-element variants, sparse storage, printing
+    and parsing, each on its own, and reports ns/op and throughput.
+
+    Usage: bench [options]
+        --sizes=PxR,...        grid points, e.g. 1000x32,10000x256 (default: P in 100, 1000, 10000
+                               by R in 4, 32, 256)
+        --time=SECONDS         minimum time per measurement (default 0.2)
+        --threads=N            threads of the parallel engine (default: all hardware threads)
+        --simd=auto|scalar|avx2|avx512   overrides the vector kernel dispatch
+*/
+
+// Microbenchmarks for the hot paths: random safe and unsafe states over a grid of P x R, with
+// every operation timed on its own and reported as ns/op and throughput
+namespace bench {
+    typedef chrono::steady_clock Clock;
+
+    volatile long long sink;           // keeps benchmarked results alive
+
+    // Stream buffer that discards everything, for timing the formatters alone
+    class NullBuffer : public streambuf {
+        protected:
+            streamsize xsputn(const char*, streamsize n) override { return n; }
+            int overflow(int c) override { return c; }
+    };
+
+    enum StateKind {
+        Safe,           // safe, processes able to finish in a random order
+        Unsafe,         // as Safe, but the last process in that order can never finish
+        Adversarial     // safe, but each process is only unblocked by the one after it in pid order,
+                        // the worst case for the sweep (one process per pass)
+    };
+
+    // Random state built along a chosen finishing order: each process's need is drawn no larger than
+    // the Work available at its turn, so the state is safe by construction. With density < 1 each
+    // Max/Allocation cell is nonzero only with that probability (zeroed cells need nothing).
+    BankersAlgorithm randomState(int numProcesses, int numResources, StateKind kind, mt19937& rng,
+                                 double density = 1.0) {
+        BankersAlgorithm state(numProcesses, numResources);
+        uniform_int_distribution<int> small(0, 9);
+        vector<int> work(numResources), order(numProcesses);
+        for (int j = 0; j < numResources; ++j) work[j] = small(rng);
+        copy(work.begin(), work.end(), state.availableData());
+        for (int i = 0; i < numProcesses; ++i) order[i] = kind == Adversarial ? numProcesses - 1 - i : i;
+        if (kind != Adversarial) shuffle(order.begin(), order.end(), rng);
+
+        int* maxData = state.maxData();
+        int* allocationData = state.allocationData();
+        for (int pid : order) {
+            int* maxRow = maxData + (size_t)pid * numResources;
+            int* allocationRow = allocationData + (size_t)pid * numResources;
+            for (int j = 0; j < numResources; ++j) {
+                if (density < 1.0 && uniform_real_distribution<double>(0.0, 1.0)(rng) >= density) continue;
+                allocationRow[j] = small(rng);
+                maxRow[j] = allocationRow[j] + uniform_int_distribution<int>(0, work[j])(rng);
+            }
+            if (kind == Adversarial) {
+                // needs all of resource 0 available so far; holding some makes the next one wait for it
+                allocationRow[0] = 1 + small(rng);
+                maxRow[0] = allocationRow[0] + work[0];
+            }
+            for (int j = 0; j < numResources; ++j) work[j] += allocationRow[j];
+        }
+        if (kind == Unsafe && numProcesses > 0) {
+            int last = order.back();
+            maxData[(size_t)last * numResources] = allocationData[(size_t)last * numResources] + work[0] + 1;
+        }
+        state.computeNeed();
+        return state;
+    }
+
+    // Run body repeatedly, doubling the batch until it takes at least minSeconds; ns per call
+    double timeIt(const function<void()>& body, double minSeconds) {
+        for (long long iterations = 1; ; iterations *= 2) {
+            Clock::time_point start = Clock::now();
+            for (long long k = 0; k < iterations; ++k) body();
+            double elapsed = chrono::duration<double>(Clock::now() - start).count();
+            if (elapsed >= minSeconds || iterations >= (1LL << 40)) return elapsed * 1e9 / (double)iterations;
+        }
+    }
+
+    // Throughput is unitsPerOp / unitScale per second, e.g. cells per op in millions of cells/s
+    void report(const string& name, int numProcesses, int numResources, double nsPerOp,
+                double unitsPerOp, double unitScale, const char* unit) {
+        cout << left << setw(34) << name << right << setw(8) << numProcesses << setw(6) << numResources
+             << fixed << setprecision(1) << setw(16) << nsPerOp
+             << setw(14) << unitsPerOp / unitScale / (nsPerOp * 1e-9) << ' ' << unit << "\n";
+        cout.unsetf(ios::floatfield);
+        cout.flush();
+    }
+
+    // The sweep and the request path again on BasicBankersAlgorithm<Width, T>: a fixed width R,
+    // or a narrower element type; suffix names the variant
+    template <int Width, class T>
+    void runVariant(const string& suffix, const BankersAlgorithm& safeState, const BankersAlgorithm& adversarialState,
+                    const vector<int>& pids, const vector<vector<int>>& requests, double minSeconds) {
+        typedef BasicBankersAlgorithm<Width, T> Variant;
+        int numProcesses = safeState.processCount();
+        int R = safeState.resourceCount();
+        double cells = (double)numProcesses * R;
+        Variant safe = Variant::adopt(BankersAlgorithm(safeState));
+        Variant adversarial = Variant::adopt(BankersAlgorithm(adversarialState));
+        report("isSafe/sweep/safe/" + suffix, numProcesses, R,
+               timeIt([&] { sink = safe.isSafe(); }, minSeconds), cells, 1e6, "Mcells/s");
+        report("isSafe/sweep/adversarial/" + suffix, numProcesses, R,
+               timeIt([&] { sink = adversarial.isSafe(); }, minSeconds), cells, 1e6, "Mcells/s");
+
+        int next = 0;
+        int count = (int)pids.size();
+        report("canRequest/" + suffix, numProcesses, R, timeIt([&] {
+            sink = safe.canRequest(pids[next], requests[next]);
+            next = (next + 1) % count;
+        }, minSeconds), 1, 1e6, "Mops/s");
+        report("applyRequest+rollback/" + suffix, numProcesses, R, timeIt([&] {
+            safe.beginTransaction();
+            safe.applyRequest(pids[next], requests[next]);
+            safe.rollback();
+            next = (next + 1) % count;
+        }, minSeconds), 1, 1e6, "Mops/s");
+    }
+
+    // Dense rows against CSR rows on a mostly-zero state (2% of the cells nonzero)
+    void runSparse(int numProcesses, int numResources, double minSeconds, mt19937& rng) {
+        BankersAlgorithm dense = randomState(numProcesses, numResources, Safe, rng, 0.02);
+        SparseBankersAlgorithm<int> sparse = SparseBankersAlgorithm<int>::fromDense(BankersAlgorithm(dense));
+        double cells = (double)numProcesses * numResources;
+        const SafetyEngine engines[] = { SafetyEngine::Sweep, SafetyEngine::Worklist };
+        const char* engineNames[] = { "sweep", "worklist" };
+        for (int e = 0; e < 2; ++e) {
+            dense.setEngine(engines[e]);
+            sparse.setEngine(engines[e]);
+            report(string("isSafe/") + engineNames[e] + "/sparse2%/dense", numProcesses, numResources,
+                   timeIt([&] { sink = dense.isSafe(); }, minSeconds), cells, 1e6, "Mcells/s");
+            report(string("isSafe/") + engineNames[e] + "/sparse2%/csr", numProcesses, numResources,
+                   timeIt([&] { sink = sparse.isSafe(); }, minSeconds), cells, 1e6, "Mcells/s");
+        }
+        report("computeNeed/sparse2%/dense", numProcesses, numResources,
+               timeIt([&] { dense.computeNeed(); }, minSeconds), cells, 1e6, "Mcells/s");
+        report("computeNeed/sparse2%/csr", numProcesses, numResources,
+               timeIt([&] { sparse.computeNeed(); }, minSeconds), cells, 1e6, "Mcells/s");
+    }
+
+    // One (P, R) point of the grid
+    void runSize(int numProcesses, int numResources, double minSeconds, int threads, mt19937& rng) {
+        double cells = (double)numProcesses * numResources;
+        BankersAlgorithm states[3] = { randomState(numProcesses, numResources, Safe, rng),
+                                       randomState(numProcesses, numResources, Unsafe, rng),
+                                       randomState(numProcesses, numResources, Adversarial, rng) };
+        const char* stateNames[] = { "safe", "unsafe", "adversarial" };
+        BankersAlgorithm& safeState = states[Safe];
+        for (BankersAlgorithm& state : states) state.setThreads(threads);
+
+        report("computeNeed", numProcesses, numResources,
+               timeIt([&] { safeState.computeNeed(); }, minSeconds), cells, 1e6, "Mcells/s");
+
+        const SafetyEngine engines[] = { SafetyEngine::Sweep, SafetyEngine::Worklist, SafetyEngine::Parallel };
+        const char* engineNames[] = { "sweep", "worklist", "parallel" };
+        for (int e = 0; e < 3; ++e) {
+            for (int k = 0; k < 3; ++k) {
+                BankersAlgorithm& state = states[k];
+                state.setEngine(engines[e]);
+                report(string("isSafe/") + engineNames[e] + "/" + stateNames[k], numProcesses, numResources,
+                       timeIt([&] { sink = state.isSafe(); }, minSeconds), cells, 1e6, "Mcells/s");
+            }
+        }
+        safeState.setEngine(SafetyEngine::Sweep);
+
+        // Requests for random processes, small enough to pass canRequest() most of the time
+        const int kRequests = 1024;
+        vector<int> pids(kRequests);
+        vector<vector<int>> requests(kRequests, vector<int>(numResources, 0));
+        for (int k = 0; k < kRequests; ++k) {
+            pids[k] = uniform_int_distribution<int>(0, numProcesses - 1)(rng);
+            for (int j = 0; j < numResources; ++j) requests[k][j] = uniform_int_distribution<int>(0, 1)(rng);
+        }
+        int next = 0;
+        report("canRequest", numProcesses, numResources, timeIt([&] {
+            sink = safeState.canRequest(pids[next], requests[next]);
+            next = (next + 1) % kRequests;
+        }, minSeconds), 1, 1e6, "Mops/s");
+        report("applyRequest+rollback", numProcesses, numResources, timeIt([&] {
+            safeState.beginTransaction();
+            safeState.applyRequest(pids[next], requests[next]);
+            safeState.rollback();
+            next = (next + 1) % kRequests;
+        }, minSeconds), 1, 1e6, "Mops/s");
+
+        // Full request cycle with the incremental safety check
+        safeState.setIncremental(true);
+        report("request+isSafe/incremental", numProcesses, numResources, timeIt([&] {
+            if (safeState.canRequest(pids[next], requests[next])) {
+                safeState.beginTransaction();
+                safeState.applyRequest(pids[next], requests[next]);
+                sink = safeState.isSafe();
+                safeState.rollback();
+            }
+            next = (next + 1) % kRequests;
+        }, minSeconds), 1, 1e6, "Mops/s");
+        safeState.setIncremental(false);
+
+        const BankersAlgorithm& adversarialState = states[Adversarial];
+        switch (numResources) {
+            case 3: runVariant<3, int>("fixed", safeState, adversarialState, pids, requests, minSeconds); break;
+            case 4: runVariant<4, int>("fixed", safeState, adversarialState, pids, requests, minSeconds); break;
+            case 8: runVariant<8, int>("fixed", safeState, adversarialState, pids, requests, minSeconds); break;
+            case 16: runVariant<16, int>("fixed", safeState, adversarialState, pids, requests, minSeconds); break;
+            default: break;
+        }
+        // Narrow element types, for as long as the states fit in them
+        ElementType narrowest = std::max(elementTypeFor(safeState), elementTypeFor(adversarialState));
+        if (narrowest == ElementType::UInt8) {
+            runVariant<0, uint8_t>("uint8", safeState, adversarialState, pids, requests, minSeconds);
+        }
+        if (narrowest <= ElementType::UInt16) {
+            runVariant<0, uint16_t>("uint16", safeState, adversarialState, pids, requests, minSeconds);
+        }
+
+        if (numResources >= 64) runSparse(numProcesses, numResources, minSeconds, rng);
+
+        // Printing and parsing the textual format
+        NullBuffer nullBuffer;
+        ostream nullStream(&nullBuffer);
+        report("printState", numProcesses, numResources,
+               timeIt([&] { safeState.printState(nullStream); }, minSeconds), 3 * cells, 1e6, "Mvalues/s");
+
+        ostringstream text;
+        {
+            RowWriter out(text);
+            out.text("R ");
+            out.integer(numResources);
+            out.text("\nP ");
+            out.integer(numProcesses);
+            out.line("\nAvailable");
+            out.rows(safeState.availableData(), 1, numResources);
+            out.line("Max");
+            out.rows(safeState.maxData(), numProcesses, numResources);
+            out.line("Allocation");
+            out.rows(safeState.allocationData(), numProcesses, numResources);
+        }
+        string input = text.str();
+        BankersAlgorithm parsed(0, 0);
+        string error;
+        report("parseState", numProcesses, numResources, timeIt([&] {
+            InputScanner in;
+            in.openBuffer(input.data(), input.size());
+            sink = parseState(in, parsed, error);
+        }, minSeconds), (double)input.size(), 1 << 20, "MiB/s");
+    }
+
+    // sizes like "1000x32,10000x256"; empty runs the default grid
+    int run(const string& sizes, double minSeconds, int threads) {
+        vector<pair<int, int>> grid;
+        if (sizes.empty()) {
+            const int processCounts[] = { 100, 1000, 10000 };
+            const int resourceCounts[] = { 4, 32, 256 };
+            for (int p : processCounts) for (int r : resourceCounts) grid.push_back(make_pair(p, r));
+        } else {
+            stringstream list(sizes);
+            string item;
+            while (getline(list, item, ',')) {
+                int p = 0, r = 0;
+                if (sscanf(item.c_str(), "%dx%d", &p, &r) != 2 || p < 1 || r < 1) {
+                    cerr << "Invalid benchmark size '" << item << "' (expected PxR)\n";
+                    return 1;
+                }
+                grid.push_back(make_pair(p, r));
+            }
+        }
+
+        cout << "SIMD kernels: " << kernels::active().name << ", threads: " << threads << "\n";
+        cout << left << setw(34) << "benchmark" << right << setw(8) << "P" << setw(6) << "R"
+             << setw(16) << "ns/op" << setw(14) << "throughput" << "\n";
+        mt19937 rng(3113);
+        for (const pair<int, int>& size : grid) {
+            runSize(size.first, size.second, minSeconds, threads, rng);
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[]){
+    string sizes;
+    double minSeconds = 0.2;
+    int threads = (int)thread::hardware_concurrency();
+    for (int a = 1; a < argc; ++a) {
+        string arg = argv[a];
+        if (arg.compare(0, 8, "--sizes=") == 0) sizes = arg.substr(8);
+        else if (arg.compare(0, 7, "--time=") == 0) minSeconds = atof(arg.c_str() + 7);
+        else if (arg.compare(0, 10, "--threads=") == 0) {
+            threads = atoi(arg.c_str() + 10);
+            if (threads < 1) { cerr << "Invalid thread count '" << arg.substr(10) << "'\n"; return 1; }
+        }
+        else if (arg.compare(0, 7, "--simd=") == 0) {
+            if (!kernels::force(arg.substr(7))) {
+                cerr << "SIMD kernels '" << arg.substr(7) << "' are not available on this CPU\n";
+                return 1;
+            }
+        }
+        else { cerr << "Unknown option '" << arg << "'\n"; return 1; }
+    }
+    ios::sync_with_stdio(false);
+    return bench::run(sizes, minSeconds, threads);
+}
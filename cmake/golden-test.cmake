@@ -0,0 +1,16 @@
+# Runs PROGRAM with ARGS on INPUT and fails unless its standard output matches EXPECTED byte for byte.
+#
+# Expects PROGRAM, INPUT and EXPECTED; ARGS is an optional ;-list of command-line options.
+
+execute_process(COMMAND ${PROGRAM} ${ARGS}
+                INPUT_FILE ${INPUT}
+                OUTPUT_VARIABLE actual
+                RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${PROGRAM} ${ARGS} < ${INPUT} exited with ${result}")
+endif()
+
+file(READ ${EXPECTED} expected)
+if(NOT actual STREQUAL expected)
+    message(FATAL_ERROR "${PROGRAM} ${ARGS} < ${INPUT} does not match ${EXPECTED}; it printed:\n${actual}")
+endif()
@@ -0,0 +1,51 @@
+# Trains a -pgo target: runs its instrumented binary over WORKLOAD, then copies the profile it wrote
+# next to the object file the -pgo target is compiled into.
+#   WORKLOAD=requests    project3 over a generated request/release/finish stream, in batch (with the
+#                        sweep, worklist and incremental checks), verbose and --what-if mode
+#   WORKLOAD=bench       the benchmarks over BENCH_SIZES (safety engines, request/rollback cycle,
+#                        printing, parsing)
+#
+# Expects WORKLOAD, INSTRUMENTED, GENERATOR, PROFILE_OBJECTS, TARGET_OBJECTS, BENCH_SIZES, WORK_DIR and STAMP.
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+# GCC writes OBJECT.gcda for OBJECT.o; drop the profile of a previous run so counts do not accumulate
+string(REGEX REPLACE "\\.o(bj)?$" ".gcda" profile "${PROFILE_OBJECTS}")
+string(REGEX REPLACE "\\.o(bj)?$" ".gcda" target_profile "${TARGET_OBJECTS}")
+file(REMOVE ${profile})
+
+function(run)
+    cmake_parse_arguments(RUN "" "INPUT" "COMMAND" ${ARGN})
+    if(RUN_INPUT)
+        set(input INPUT_FILE ${RUN_INPUT})
+    endif()
+    execute_process(COMMAND ${RUN_COMMAND} ${input} OUTPUT_QUIET RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "PGO training step failed (${result}): ${RUN_COMMAND}")
+    endif()
+endfunction()
+
+if(WORKLOAD STREQUAL "bench")
+    run(COMMAND ${INSTRUMENTED} --sizes=${BENCH_SIZES} --time=0.05)
+elseif(WORKLOAD STREQUAL "requests")
+    set(workload ${WORK_DIR}/workload.txt)
+    run(COMMAND ${GENERATOR} --processes=2000 --resources=16 --requests=20000 --release-ratio=0.2
+                --finish-ratio=0.05 --output=${workload})
+    run(COMMAND ${INSTRUMENTED} --batch INPUT ${workload})
+    run(COMMAND ${INSTRUMENTED} --batch --engine=worklist INPUT ${workload})
+    run(COMMAND ${INSTRUMENTED} --batch --incremental INPUT ${workload})
+    run(COMMAND ${INSTRUMENTED} INPUT ${workload})
+    set(requests_only ${WORK_DIR}/requests-only.txt)
+    run(COMMAND ${GENERATOR} --processes=2000 --resources=16 --requests=20000 --output=${requests_only})
+    run(COMMAND ${INSTRUMENTED} --what-if INPUT ${requests_only})
+else()
+    message(FATAL_ERROR "Unknown PGO workload '${WORKLOAD}'")
+endif()
+
+if(NOT EXISTS ${profile})
+    message(FATAL_ERROR "PGO training wrote no profile (expected ${profile})")
+endif()
+get_filename_component(target_dir ${target_profile} DIRECTORY)
+file(MAKE_DIRECTORY ${target_dir})
+configure_file(${profile} ${target_profile} COPYONLY)
+file(TOUCH ${STAMP})
@@ -0,0 +1,400 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+/*
+    Synthetic workload generator for the Banker's Algorithm (project3).
+
+    What this file does:
+    - Emits inputs in the same R/P/Available/Max/Allocation format project3 reads, followed by an
+    optional stream of request lines ("P1 1 0 2") mixed with "Release" and "Finish" directives.
+    - States are built along a chosen finishing order, so they are safe by construction; a
+    requested fraction of them is made unsafe by raising one process's need past everything in
+    the system. The adversarial ordering makes each process wait for the one after it in pid
+    order, the worst case for the sweep in isSafe().
+    - Output is formatted into a large buffer and written in big chunks.
+
+    Usage: generator [options] > input.txt
+        --processes=N          number of processes (default 5)
+        --resources=N          number of resource types (default 3)
+        --max-value=N          largest Available/Allocation value drawn (default 9)
+        --dist=uniform|skewed|sparse
+                               value distribution: uniform on [0, max], skewed towards small values,
+                               or sparse (zero unless a --density coin flip succeeds)
+        --density=F            nonzero fraction for --dist=sparse (default 0.05)
+        --unsafe-ratio=F       fraction of generated states that are unsafe (default 0)
+        --adversarial          worst-case finishing order for the sweep
+        --requests=N           number of request/directive lines after the state (default 0)
+        --release-ratio=F      fraction of those lines that are Release directives (default 0)
+        --finish-ratio=F       fraction of those lines that are Finish directives (default 0)
+        --count=N              number of files to generate (default 1)
+        --output=PATH          output file; with --count > 1, files PATH.0, PATH.1, ... (default stdout)
+        --seed=N               random seed (default 3113)
+*/
+
+
+// xoshiro256** generator: much faster than <random> engines and distributions, which would
+// otherwise dominate the time spent producing large files
+class Random {
+    private:
+        uint64_t s[4];
+        uint64_t bits = 0;       // unused random bits for upTo(), consumed 16 at a time
+        int bitsLeft = 0;
+
+        static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    public:
+        explicit Random(uint64_t seed) {
+            // splitmix64 to spread the seed over the state
+            for (int k = 0; k < 4; ++k) {
+                uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                s[k] = z ^ (z >> 31);
+            }
+        }
+
+        uint64_t next() {
+            uint64_t result = rotl(s[1] * 5, 7) * 9;
+            uint64_t t = s[1] << 17;
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= t;
+            s[3] = rotl(s[3], 45);
+            return result;
+        }
+
+        // Uniform on [0, bound] (bound >= 0). Small bounds, the common case, take 16 bits of a
+        // cached word at a time (bias below 2^-16 * bound), so one next() serves four draws.
+        int upTo(int bound) {
+            if (bound >= 0x10000) return (int)(((next() >> 32) * ((uint64_t)bound + 1)) >> 32);
+            if (bitsLeft == 0) {
+                bits = next();
+                bitsLeft = 4;
+            }
+            uint64_t chunk = bits & 0xffff;
+            bits >>= 16;
+            --bitsLeft;
+            return (int)((chunk * ((uint64_t)bound + 1)) >> 16);
+        }
+
+        // Uniform on [0, 1)
+        double unit() {
+            return (double)(next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+};
+
+enum class Distribution { Uniform, Skewed, Sparse };
+
+// Everything the command line controls
+struct Options {
+    int processes = 5;
+    int resources = 3;
+    int maxValue = 9;
+    Distribution dist = Distribution::Uniform;
+    double density = 0.05;
+    double unsafeRatio = 0.0;
+    bool adversarial = false;
+    long long requests = 0;
+    double releaseRatio = 0.0;
+    double finishRatio = 0.0;
+    int count = 1;
+    string output;
+    uint64_t seed = 3113;
+};
+
+// Buffered writer with a two-digits-at-a-time integer conversion, flushed in 1 MiB chunks
+class Writer {
+    private:
+        FILE* file;
+        vector<char> buffer;
+        size_t used = 0;
+        bool failed = false;
+
+        void reserve(size_t n) {
+            if (buffer.size() - used < n) flush();
+        }
+
+    public:
+        explicit Writer(FILE* f) : file(f), buffer(1 << 20) {}
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+        ~Writer() { flush(); }
+
+        bool ok() const { return !failed; }
+
+        void put(char c) {
+            reserve(1);
+            buffer[used++] = c;
+        }
+
+        void text(const char* s) {
+            size_t n = strlen(s);
+            reserve(n);
+            memcpy(buffer.data() + used, s, n);
+            used += n;
+        }
+
+        void integer(int value) {
+            reserve(11);
+            append(value);
+        }
+
+        // Space-separated values followed by '\n'; one capacity check for the whole row
+        void row(const int* values, int n) {
+            if ((size_t)n * 12 + 1 > buffer.size()) {
+                for (int j = 0; j < n; ++j) {
+                    if (j) put(' ');
+                    integer(values[j]);
+                }
+                put('\n');
+                return;
+            }
+            reserve((size_t)n * 12 + 1);
+            for (int j = 0; j < n; ++j) {
+                append(values[j]);
+                buffer[used++] = ' ';
+            }
+            if (n) --used;
+            buffer[used++] = '\n';
+        }
+
+        void flush() {
+            if (used && fwrite(buffer.data(), 1, used, file) != used) failed = true;
+            used = 0;
+        }
+
+    private:
+        // Format value at the end of the buffer; the caller has reserved 11 bytes
+        void append(int value) {
+            static const char digitPairs[] =
+                "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                "8081828384858687888990919293949596979899";
+            if ((unsigned int)value < 10) {
+                buffer[used++] = (char)('0' + value);
+                return;
+            }
+            char tmp[11];
+            char* p = tmp + 11;
+            unsigned int v = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+            while (v >= 100) {
+                unsigned int pair = (v % 100) * 2;
+                v /= 100;
+                *--p = digitPairs[pair + 1];
+                *--p = digitPairs[pair];
+            }
+            if (v >= 10) {
+                *--p = digitPairs[v * 2 + 1];
+                *--p = digitPairs[v * 2];
+            } else {
+                *--p = (char)('0' + v);
+            }
+            if (value < 0) *--p = '-';
+            size_t n = (size_t)(tmp + 11 - p);
+            memcpy(buffer.data() + used, p, n);
+            used += n;
+        }
+};
+
+// One value on [0, bound] drawn from distribution D
+template <Distribution D>
+inline int draw(Random& rng, double density, int bound) {
+    if (bound <= 0) return 0;
+    if (D == Distribution::Skewed) {
+        // minimum of three uniforms: mostly small values, occasionally up to bound
+        int v = rng.upTo(bound);
+        v = min(v, rng.upTo(bound));
+        return min(v, rng.upTo(bound));
+    }
+    if (D == Distribution::Sparse) return rng.unit() < density ? 1 + rng.upTo(bound - 1) : 0;
+    return rng.upTo(bound);
+}
+
+// Fill the Available vector and the Max and Allocation rows of every process, visiting them in
+// order; each process's need is at most the Work available at its turn, so order is a safe sequence.
+// Templated on the distribution so the per-value loop has no dispatch in it.
+template <Distribution D>
+void fillState(const Options& options, const vector<int>& order, vector<int>& available, vector<int>& work,
+               vector<int>& maxMatrix, vector<int>& allocation, Random& rng) {
+    const int R = options.resources;
+    const int maxValue = options.maxValue;
+    const double density = options.density;
+    for (int j = 0; j < R; ++j) available[j] = work[j] = draw<D>(rng, density, maxValue);
+
+    for (int pid : order) {
+        int* maxRow = maxMatrix.data() + (size_t)pid * R;
+        int* allocationRow = allocation.data() + (size_t)pid * R;
+        for (int j = 0; j < R; ++j) {
+            int held = draw<D>(rng, density, maxValue);
+            allocationRow[j] = held;
+            maxRow[j] = held + draw<D>(rng, density, min(work[j], maxValue));
+        }
+        if (options.adversarial && R > 0) {
+            // needs all of resource 0 available so far, and holds some of it so the next process
+            // in pid order has to wait for this one
+            allocationRow[0] = 1 + rng.upTo(max(0, maxValue - 1));
+            maxRow[0] = allocationRow[0] + work[0];
+        }
+        for (int j = 0; j < R; ++j) work[j] += allocationRow[j];
+    }
+}
+
+// Generate one state (and its request stream) into out
+void generate(Writer& out, const Options& options, bool unsafe, Random& rng) {
+    int P = options.processes;
+    int R = options.resources;
+    vector<int> available(R), work(R), order(P);
+    vector<int> maxMatrix((size_t)P * R), allocation((size_t)P * R);
+
+    // Finishing order: reversed pid order when adversarial, otherwise a random permutation
+    for (int i = 0; i < P; ++i) order[i] = options.adversarial ? P - 1 - i : i;
+    if (!options.adversarial) {
+        for (int i = P - 1; i > 0; --i) swap(order[i], order[rng.upTo(i)]);
+    }
+
+    switch (options.dist) {
+        case Distribution::Skewed:
+            fillState<Distribution::Skewed>(options, order, available, work, maxMatrix, allocation, rng);
+            break;
+        case Distribution::Sparse:
+            fillState<Distribution::Sparse>(options, order, available, work, maxMatrix, allocation, rng);
+            break;
+        case Distribution::Uniform:
+        default:
+            fillState<Distribution::Uniform>(options, order, available, work, maxMatrix, allocation, rng);
+            break;
+    }
+
+    // Unsafe: the last process in the order needs more of resource 0 than the system has
+    if (unsafe && P > 0 && R > 0) {
+        int last = order.back();
+        maxMatrix[(size_t)last * R] = allocation[(size_t)last * R] + work[0] + 1;
+    }
+
+    out.text("R ");
+    out.integer(R);
+    out.text("\nP ");
+    out.integer(P);
+    out.text("\nAvailable\n");
+    out.row(available.data(), R);
+    out.text("Max\n");
+    for (int i = 0; i < P; ++i) out.row(maxMatrix.data() + (size_t)i * R, R);
+    out.text("Allocation\n");
+    for (int i = 0; i < P; ++i) out.row(allocation.data() + (size_t)i * R, R);
+
+    // Request stream. Requests stay within the process's need and what is available, and releases
+    // within its allocation, as tracked by assuming every request is granted, so most lines are
+    // plausible for project3.
+    if (options.requests <= 0 || P == 0) return;
+    vector<int> need((size_t)P * R), amounts(R);
+    for (size_t k = 0; k < need.size(); ++k) need[k] = max(0, maxMatrix[k] - allocation[k]);
+    for (long long n = 0; n < options.requests; ++n) {
+        int pid = rng.upTo(P - 1);
+        int* needRow = need.data() + (size_t)pid * R;
+        int* allocationRow = allocation.data() + (size_t)pid * R;
+        double kind = rng.unit();
+        if (kind < options.finishRatio) {
+            out.text("Finish P");
+            out.integer(pid);
+            out.put('\n');
+            for (int j = 0; j < R; ++j) available[j] += allocationRow[j];
+            fill(needRow, needRow + R, 0);
+            fill(allocationRow, allocationRow + R, 0);
+            continue;
+        }
+        bool release = kind < options.finishRatio + options.releaseRatio;
+        for (int j = 0; j < R; ++j) {
+            amounts[j] = rng.upTo(release ? allocationRow[j] : min(min(needRow[j], available[j]), 2));
+            int delta = release ? -amounts[j] : amounts[j];
+            allocationRow[j] += delta;
+            needRow[j] -= delta;
+            available[j] -= delta;
+        }
+        if (release) out.text("Release ");
+        out.put('P');
+        out.integer(pid);
+        out.put(' ');
+        out.row(amounts.data(), R);
+    }
+}
+
+// Parse "--name=value" into value; returns false if arg is a different option
+bool optionValue(const string& arg, const char* name, string& value) {
+    size_t n = strlen(name);
+    if (arg.compare(0, n, name) != 0 || arg.size() <= n || arg[n] != '=') return false;
+    value = arg.substr(n + 1);
+    return true;
+}
+
+int main(int argc, char* argv[]){
+    Options options;
+    for (int a = 1; a < argc; ++a) {
+        string arg = argv[a], value;
+        if (optionValue(arg, "--processes", value)) options.processes = atoi(value.c_str());
+        else if (optionValue(arg, "--resources", value)) options.resources = atoi(value.c_str());
+        else if (optionValue(arg, "--max-value", value)) options.maxValue = atoi(value.c_str());
+        else if (optionValue(arg, "--dist", value)) {
+            if (value == "uniform") options.dist = Distribution::Uniform;
+            else if (value == "skewed") options.dist = Distribution::Skewed;
+            else if (value == "sparse") options.dist = Distribution::Sparse;
+            else { cerr << "Unknown distribution '" << value << "'\n"; return 1; }
+        }
+        else if (optionValue(arg, "--density", value)) options.density = atof(value.c_str());
+        else if (optionValue(arg, "--unsafe-ratio", value)) options.unsafeRatio = atof(value.c_str());
+        else if (arg == "--adversarial") options.adversarial = true;
+        else if (optionValue(arg, "--requests", value)) options.requests = atoll(value.c_str());
+        else if (optionValue(arg, "--release-ratio", value)) options.releaseRatio = atof(value.c_str());
+        else if (optionValue(arg, "--finish-ratio", value)) options.finishRatio = atof(value.c_str());
+        else if (optionValue(arg, "--count", value)) options.count = atoi(value.c_str());
+        else if (optionValue(arg, "--output", value)) options.output = value;
+        else if (optionValue(arg, "--seed", value)) options.seed = strtoull(value.c_str(), nullptr, 10);
+        else { cerr << "Unknown option '" << arg << "'\n"; return 1; }
+    }
+    if (options.processes < 0 || options.resources < 0 || options.maxValue < 0 || options.count < 1) {
+        cerr << "Counts and --max-value must not be negative\n";
+        return 1;
+    }
+    if (options.count > 1 && options.output.empty()) {
+        cerr << "--count > 1 needs --output\n";
+        return 1;
+    }
+
+    Random rng(options.seed);
+
+    // Exactly round(count * ratio) of the files are unsafe, in random positions
+    int unsafeCount = (int)(options.count * options.unsafeRatio + 0.5);
+    vector<char> unsafe(options.count, 0);
+    for (int k = 0; k < unsafeCount && k < options.count; ++k) unsafe[k] = 1;
+    for (int k = options.count - 1; k > 0; --k) swap(unsafe[k], unsafe[rng.upTo(k)]);
+    if (options.count == 1) unsafe[0] = rng.unit() < options.unsafeRatio;
+
+    for (int k = 0; k < options.count; ++k) {
+        FILE* file = stdout;
+        string path = options.output;
+        if (options.count > 1) path += "." + to_string(k);
+        if (!path.empty()) {
+            file = fopen(path.c_str(), "wb");
+            if (!file) { cerr << "Cannot open '" << path << "' for writing\n"; return 1; }
+        }
+        bool ok;
+        {
+            Writer out(file);
+            generate(out, options, unsafe[k], rng);
+            out.flush();
+            ok = out.ok();
+        }
+        if (file != stdout && fclose(file) != 0) ok = false;
+        if (!ok) { cerr << "Write failed for '" << (path.empty() ? "stdout" : path) << "'\n"; return 1; }
+    }
+    return 0;
+}
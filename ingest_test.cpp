@@ -0,0 +1,196 @@
+#include "bankers.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+using namespace bankers;
+
+/*
+    Stress check for RequestIngest (bankers.h), registered with ctest.
+
+    What this file does:
+    - Builds a random safe state and floods a RequestIngest with random requests from 4 producer
+    threads while the main thread decides them (with the incremental safety check).
+    - Fails if submit() queues a request of the wrong length, if any ticket is answered twice, out of
+    order or never, or if Available moved by anything other than the sum of the granted requests. A
+    producer that sees no progress for 5 seconds gives up, so a lost request fails the check instead
+    of hanging it.
+
+    Usage: ingest_test [--sizes=PxR,...]  (default 100x4,1000x32); exits 1 on the first failed size
+*/
+
+namespace ingest_test {
+    typedef chrono::steady_clock Clock;
+
+    // Random state built along a shuffled finishing order: each process's need is drawn no larger than
+    // the Work available at its turn, so the state is safe by construction
+    BankersAlgorithm randomState(int numProcesses, int numResources, mt19937& rng) {
+        BankersAlgorithm state(numProcesses, numResources);
+        uniform_int_distribution<int> small(0, 9);
+        vector<int> work(numResources), order(numProcesses);
+        for (int j = 0; j < numResources; ++j) work[j] = small(rng);
+        copy(work.begin(), work.end(), state.availableData());
+        for (int i = 0; i < numProcesses; ++i) order[i] = i;
+        shuffle(order.begin(), order.end(), rng);
+
+        for (int pid : order) {
+            int* maxRow = state.maxData() + (size_t)pid * numResources;
+            int* allocationRow = state.allocationData() + (size_t)pid * numResources;
+            for (int j = 0; j < numResources; ++j) {
+                allocationRow[j] = small(rng);
+                maxRow[j] = allocationRow[j] + uniform_int_distribution<int>(0, work[j])(rng);
+                work[j] += allocationRow[j];
+            }
+        }
+        state.computeNeed();
+        return state;
+    }
+
+    bool run(int numProcesses, int numResources, mt19937& rng) {
+        const int kProducers = 4;
+        const int kRequestsPerProducer = 1 << 14;
+        const chrono::seconds kStallLimit(5);
+        BankersAlgorithm state = randomState(numProcesses, numResources, rng);
+        state.setIncremental(true);
+        vector<int64_t> availableBefore(state.availableData(), state.availableData() + numResources);
+
+        vector<vector<int>> pids(kProducers);
+        vector<vector<vector<int>>> requests(kProducers);
+        for (int p = 0; p < kProducers; ++p) {
+            for (int k = 0; k < 256; ++k) {
+                pids[p].push_back(uniform_int_distribution<int>(0, numProcesses - 1)(rng));
+                vector<int> request(numResources);
+                for (int& v : request) v = uniform_int_distribution<int>(0, 1)(rng);
+                requests[p].push_back(request);
+            }
+        }
+
+        RequestIngest<BankersAlgorithm> ingest(state);
+        vector<RequestIngest<BankersAlgorithm>::Producer*> producers;
+        for (int p = 0; p < kProducers; ++p) producers.push_back(&ingest.addProducer());
+        vector<string> failures(kProducers);
+        vector<vector<char>> seen(kProducers, vector<char>(kRequestsPerProducer, 0));
+        vector<vector<int64_t>> granted(kProducers, vector<int64_t>(numResources, 0));
+        atomic<int> done{0};
+
+        // a request of the wrong length is refused up front instead of being read past its end
+        uint64_t rejected;
+        if (producers[0]->submit(0, vector<int>(numResources + 1, 0), rejected) ||
+            producers[0]->submit(0, vector<int>(), rejected)) {
+            cerr << "RequestIngest check failed: a request of the wrong length was queued\n";
+            return false;
+        }
+
+        auto produce = [&](int p) {
+            RequestIngest<BankersAlgorithm>::Producer& producer = *producers[p];
+            int sent = 0, received = 0;
+            RequestIngest<BankersAlgorithm>::Reply reply;
+            uint64_t ticket;
+            Clock::time_point lastProgress = Clock::now();
+            while (received < kRequestsPerProducer) {
+                bool progressed = false;
+                while (sent < kRequestsPerProducer &&
+                       producer.submit(pids[p][sent % 256], requests[p][sent % 256], ticket)) {
+                    if (ticket != (uint64_t)sent) failures[p] = "ticket " + to_string(ticket) + " out of order";
+                    ++sent;
+                    progressed = true;
+                }
+                while (producer.poll(reply)) {
+                    if (reply.ticket >= (uint64_t)sent || seen[p][reply.ticket]) {
+                        failures[p] = "reply for ticket " + to_string(reply.ticket) + " unexpected or duplicated";
+                    } else {
+                        seen[p][reply.ticket] = 1;
+                        if (reply.decision == Decision::Granted) {
+                            const vector<int>& request = requests[p][reply.ticket % 256];
+                            for (int j = 0; j < numResources; ++j) granted[p][j] += request[j];
+                        }
+                    }
+                    ++received;
+                    progressed = true;
+                }
+                Clock::time_point now = Clock::now();
+                if (progressed) {
+                    lastProgress = now;
+                } else if (now - lastProgress > kStallLimit) {
+                    failures[p] = "stalled with " + to_string(received) + " of " + to_string(sent) +
+                                  " replies received";
+                    break;
+                } else {
+                    this_thread::yield();
+                }
+            }
+            done.fetch_add(1, memory_order_release);
+        };
+
+        Clock::time_point start = Clock::now();
+        vector<thread> threads;
+        for (int p = 0; p < kProducers; ++p) threads.emplace_back(produce, p);
+        while (done.load(memory_order_acquire) < kProducers) {
+            if (ingest.drain(256) == 0) this_thread::yield();
+        }
+        double elapsed = chrono::duration<double>(Clock::now() - start).count();
+        for (thread& t : threads) t.join();
+
+        bool ok = true;
+        for (int p = 0; p < kProducers; ++p) {
+            int missing = (int)count(seen[p].begin(), seen[p].end(), 0);
+            if (missing > 0) {
+                int first = (int)(find(seen[p].begin(), seen[p].end(), 0) - seen[p].begin());
+                cerr << "RequestIngest check failed (producer " << p << "): " << missing
+                     << " tickets never answered, the first is " << first << "\n";
+                ok = false;
+            }
+            if (failures[p].empty()) continue;
+            cerr << "RequestIngest check failed (producer " << p << "): " << failures[p] << "\n";
+            ok = false;
+        }
+        for (int j = 0; j < numResources; ++j) {
+            int64_t taken = 0;
+            for (int p = 0; p < kProducers; ++p) taken += granted[p][j];
+            if (availableBefore[j] - state.availableData()[j] != taken) {
+                cerr << "RequestIngest check failed: Available[" << j << "] moved by "
+                     << availableBefore[j] - state.availableData()[j] << ", granted requests sum to " << taken << "\n";
+                ok = false;
+                break;
+            }
+        }
+        cout << numProcesses << "x" << numResources << ": " << kProducers * kRequestsPerProducer
+             << " requests in " << elapsed << " s" << (ok ? "" : " (FAILED)") << "\n";
+        return ok;
+    }
+}
+
+int main(int argc, char* argv[]){
+    string sizes = "100x4,1000x32";
+    for (int a = 1; a < argc; ++a) {
+        string arg = argv[a];
+        if (arg.compare(0, 8, "--sizes=") == 0) sizes = arg.substr(8);
+        else { cerr << "Unknown option '" << arg << "'\n"; return 1; }
+    }
+
+    mt19937 rng(3113);
+    size_t begin = 0;
+    while (begin < sizes.size()) {
+        size_t end = sizes.find(',', begin);
+        if (end == string::npos) end = sizes.size();
+        string item = sizes.substr(begin, end - begin);
+        begin = end + 1;
+        int p = 0, r = 0;
+        if (sscanf(item.c_str(), "%dx%d", &p, &r) != 2 || p < 1 || r < 1) {
+            cerr << "Invalid size '" << item << "' (expected PxR)\n";
+            return 1;
+        }
+        if (!ingest_test::run(p, r, rng)) return 1;
+    }
+    return 0;
+}
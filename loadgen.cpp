@@ -0,0 +1,232 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+    Load generator for the Banker's Algorithm daemon (project3 --serve=PATH).
+
+    What this file does:
+    - Opens a number of connections to the daemon's Unix socket, one thread each, and keeps a
+    window of requests in flight on every connection (pipelining), sending each new batch of
+    requests in one write as replies come back.
+    - Requests are random "P3 1 0 1" lines, optionally mixed with "Release" lines, for a state
+    with the given process and resource counts.
+    - Reports the overall request rate, round-trip latency percentiles and how the requests were
+    answered.
+
+    Usage: loadgen --socket=PATH [options]
+        --socket=PATH          the daemon's socket (required)
+        --connections=N        concurrent connections (default 4)
+        --requests=N           requests per connection (default 10000)
+        --depth=N              requests in flight per connection (default 16)
+        --processes=N          requests are spread over processes P0 .. PN-1 (default 5)
+        --resources=N          values per request; must match the daemon's state (default 3)
+        --max-value=N          largest value in a request (default 1)
+        --release-ratio=F      fraction of Release lines (default 0)
+        --seed=N               random seed (default 3113)
+*/
+
+typedef chrono::steady_clock Clock;
+
+struct Options {
+    string socketPath;
+    int connections = 4;
+    long long requests = 10000;
+    int depth = 16;
+    int processes = 5;
+    int resources = 3;
+    int maxValue = 1;
+    double releaseRatio = 0.0;
+    uint64_t seed = 3113;
+};
+
+// How the daemon answered, by reply line
+enum Outcome { Granted, Denied, Released, Refused, Error, Outcomes };
+
+const char* outcomeNames[] = { "granted", "denied", "released", "release refused", "error" };
+
+Outcome classify(const string& reply) {
+    if (reply.compare(0, 6, "Error:") == 0) return Error;
+    if (reply.find("request granted") != string::npos) return Granted;
+    if (reply.find("request denied") != string::npos) return Denied;
+    if (reply.find("released resources") != string::npos) return Released;
+    return reply.find("cannot be performed") != string::npos ? Refused : Error;
+}
+
+// One connection's run: latencies in microseconds and outcome counts
+struct ConnectionResult {
+    vector<double> latencies;
+    long long outcomes[Outcomes] = {};
+    string error;
+};
+
+// "--name=value" -> value
+bool optionValue(const string& arg, const char* name, string& value) {
+    size_t n = strlen(name);
+    if (arg.compare(0, n, name) != 0 || arg.size() <= n || arg[n] != '=') return false;
+    value = arg.substr(n + 1);
+    return true;
+}
+
+int connectTo(const string& path, string& error) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof address);
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof address.sun_path) {
+        error = "socket path too long";
+        return -1;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (const sockaddr*)&address, sizeof address) < 0) {
+        error = strerror(errno);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendAll(int fd, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+void runConnection(const Options& options, int index, ConnectionResult& result) {
+    int fd = connectTo(options.socketPath, result.error);
+    if (fd < 0) return;
+
+    mt19937_64 rng(options.seed + (uint64_t)index);
+    uniform_int_distribution<int> pid(0, max(options.processes - 1, 0));
+    uniform_int_distribution<int> value(0, max(options.maxValue, 0));
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    auto appendRequest = [&](string& out) {
+        if (unit(rng) < options.releaseRatio) out += "Release ";
+        out += 'P';
+        out += to_string(pid(rng));
+        for (int j = 0; j < options.resources; ++j) {
+            out += ' ';
+            out += to_string(value(rng));
+        }
+        out += '\n';
+    };
+
+    // Send times of the requests in flight, oldest first (replies come back in order)
+    vector<Clock::time_point> sentAt((size_t)options.requests);
+    long long sent = 0, answered = 0;
+    string batch, pending, line;
+    vector<char> buffer(1 << 16);
+    result.latencies.reserve((size_t)options.requests);
+
+    while (answered < options.requests) {
+        batch.clear();
+        Clock::time_point now = Clock::now();
+        while (sent < options.requests && sent - answered < options.depth) {
+            appendRequest(batch);
+            sentAt[(size_t)sent++] = now;
+        }
+        if (!batch.empty() && !sendAll(fd, batch)) {
+            result.error = string("send: ") + strerror(errno);
+            break;
+        }
+
+        ssize_t n = recv(fd, buffer.data(), buffer.size(), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            result.error = n == 0 ? "the daemon closed the connection" : string("recv: ") + strerror(errno);
+            break;
+        }
+        now = Clock::now();
+        pending.append(buffer.data(), (size_t)n);
+        size_t start = 0, newline;
+        while ((newline = pending.find('\n', start)) != string::npos && answered < options.requests) {
+            line.assign(pending, start, newline - start);
+            start = newline + 1;
+            result.outcomes[classify(line)]++;
+            result.latencies.push_back(chrono::duration<double, micro>(now - sentAt[(size_t)answered]).count());
+            ++answered;
+        }
+        pending.erase(0, start);
+    }
+    close(fd);
+}
+
+int main(int argc, char* argv[]){
+    Options options;
+    for (int a = 1; a < argc; ++a) {
+        string arg = argv[a], value;
+        if (optionValue(arg, "--socket", value)) options.socketPath = value;
+        else if (optionValue(arg, "--connections", value)) options.connections = atoi(value.c_str());
+        else if (optionValue(arg, "--requests", value)) options.requests = atoll(value.c_str());
+        else if (optionValue(arg, "--depth", value)) options.depth = atoi(value.c_str());
+        else if (optionValue(arg, "--processes", value)) options.processes = atoi(value.c_str());
+        else if (optionValue(arg, "--resources", value)) options.resources = atoi(value.c_str());
+        else if (optionValue(arg, "--max-value", value)) options.maxValue = atoi(value.c_str());
+        else if (optionValue(arg, "--release-ratio", value)) options.releaseRatio = atof(value.c_str());
+        else if (optionValue(arg, "--seed", value)) options.seed = strtoull(value.c_str(), nullptr, 10);
+        else { cerr << "Unknown option '" << arg << "'\n"; return 1; }
+    }
+    if (options.socketPath.empty()) {
+        cerr << "--socket=PATH is required\n";
+        return 1;
+    }
+    if (options.connections < 1 || options.depth < 1 || options.requests < 0 || options.processes < 1 ||
+        options.resources < 1) {
+        cerr << "--connections, --depth, --processes and --resources must be positive\n";
+        return 1;
+    }
+
+    vector<ConnectionResult> results(options.connections);
+    vector<thread> threads;
+    Clock::time_point start = Clock::now();
+    for (int k = 0; k < options.connections; ++k) {
+        threads.emplace_back(runConnection, cref(options), k, ref(results[k]));
+    }
+    for (thread& t : threads) t.join();
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    vector<double> latencies;
+    long long outcomes[Outcomes] = {};
+    int failed = 0;
+    for (int k = 0; k < options.connections; ++k) {
+        const ConnectionResult& result = results[k];
+        if (!result.error.empty()) {
+            cerr << "Connection " << k << ": " << result.error << "\n";
+            ++failed;
+        }
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+        for (int o = 0; o < Outcomes; ++o) outcomes[o] += result.outcomes[o];
+    }
+    if (latencies.empty()) {
+        cerr << "No replies received\n";
+        return 1;
+    }
+
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[min(latencies.size() - 1, (size_t)(p * latencies.size()))]; };
+    printf("%zu replies in %.3f s: %.0f requests/s over %d connections, depth %d\n", latencies.size(), seconds,
+           (double)latencies.size() / seconds, options.connections, options.depth);
+    printf("latency us: p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n", percentile(0.50), percentile(0.90),
+           percentile(0.99), latencies.back());
+    for (int o = 0; o < Outcomes; ++o) printf("%s: %lld\n", outcomeNames[o], outcomes[o]);
+    return failed ? 1 : 0;
+}
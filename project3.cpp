@@ -1,275 +1,1011 @@
+#include "bankers.h"
+
 #include <iostream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
+#include <csignal>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#ifdef BANKERS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
 
 using namespace std;
+using namespace bankers;
 
 /*
-    Implementation of the Banker's Algorithm input parsing and safety check.
+    Command-line front end for the Banker's Algorithm library (bankers.h).
 
     What this file does:
     - Parses a textual input describing resources, processes,
-    the Available vector, the Max and Allocation matrices, and an optional request.
+    the Available vector, the Max and Allocation matrices, and any number of requests.
     - Computes the Need matrix and runs the Banker's safety algorithm.
-    - Simulates granting a single request (if present) and prints formatted output
+    - Simulates granting each request in order and prints formatted output
     describing whether granting the request leaves the system in a safe state.
+    - Also evaluates requests independently (--what-if) and serves them over a Unix socket (--serve).
+    The microbenchmarks are in bench.cpp.
 */
 
 
-// Banker's Algorithm implementation
-class BankersAlgorithm {
-    private:
-        int numProcesses;                // Number of processes
-        int numResources;                // Number of resources
-        vector<vector<int>> allocation;  // Allocation matrix
-        vector<vector<int>> max;         // Maximum demand matrix
-        vector<vector<int>> need;        // Need matrix
-        vector<int> available;           // Available resources
-    public:
-        BankersAlgorithm(int processes, int resources) {    // Constructor to initialize the matrices and vectors
-            numProcesses = processes;
-            numResources = resources;
-            allocation.resize(numProcesses, vector<int>(numResources, 0));
-            max.resize(numProcesses, vector<int>(numResources, 0));
-            need.resize(numProcesses, vector<int>(numResources, 0));
-            available.resize(numResources, 0);
-        }
-
-        // Setters so main can populate the matrices after parsing input
-        void setAvailable(const vector<int>& av) {
-            if ((int)av.size() != numResources) return;
-            available = av;
-        }
-
-        void setMaxRow(int pid, const vector<int>& row) {
-            if (pid < 0 || pid >= numProcesses) return;
-            if ((int)row.size() != numResources) return;
-            max[pid] = row;
-        }
-
-        void setAllocationRow(int pid, const vector<int>& row) {
-            if (pid < 0 || pid >= numProcesses) return;
-            if ((int)row.size() != numResources) return;
-            allocation[pid] = row;
-        }
-
-        // Compute need = max - allocation for each process/resource
-        void computeNeed() {
-            for (int i = 0; i < numProcesses; ++i) {
-                for (int j = 0; j < numResources; ++j) {
-                    need[i][j] = max[i][j] - allocation[i][j];
-                    if (need[i][j] < 0) need[i][j] = 0; // guard
+// How request results are reported
+struct OutputOptions {
+    bool batch = false;          // one result line per request instead of the full report
+    bool showSequence = false;   // print the safe sequence after each "safe state" line
+    bool showWork = false;       // with it, the Work vector after each process finishes
+};
+
+// How the safety algorithm is run
+struct EngineOptions {
+    SafetyEngine engine = SafetyEngine::Sweep;
+    bool incremental = false;    // reuse the last safe sequence between checks
+    int threads = 0;             // parallel engine and what-if threads (0: all hardware threads)
+};
+
+// What to do with the lines that follow the state
+struct RunMode {
+    bool whatIf = false;         // evaluate each request against the loaded state (--what-if)
+    string servePath;            // take them from clients of this Unix socket instead (--serve=PATH)
+    string serveLoop = "epoll";  // the server's event loop: epoll or io_uring (--serve-loop=)
+};
+
+// Run the safety algorithm, keeping the safe sequence and Work trace if they are to be printed
+template <class Bankers>
+bool checkSafety(const Bankers& bankers, const OutputOptions& options,
+                 vector<int>& sequence, vector<typename Bankers::Value>& workTrace) {
+    if (!options.showSequence) return bankers.isSafe();
+    return bankers.isSafe(sequence, options.showWork ? &workTrace : nullptr);
+}
+
+// Report on stderr the disagreements the cross-check engine (--engine=check) found since the last call
+template <class Bankers>
+void reportDisagreements(Bankers& bankers) {
+    vector<EngineDisagreement> found;
+    bankers.takeEngineDisagreements(found);
+    for (const EngineDisagreement& verdicts : found) {
+        cerr << "Safety engines disagree: sweep says " << (verdicts.sweep ? "safe" : "unsafe")
+             << ", worklist says " << (verdicts.worklist ? "safe" : "unsafe")
+             << ", parallel says " << (verdicts.parallel ? "safe" : "unsafe") << "\n";
+    }
+}
+
+// The safe sequence and Work trace of the last check that found the current state safe, so the report
+// before each request can print them without running the safety algorithm again
+template <class Value>
+struct LastSafeCheck {
+    vector<int> sequence;
+    vector<Value> workTrace;
+    bool current = false;           // false until a check has run, and after a release or finish
+    vector<Value> nextWorkTrace;    // the trace of the check after a tentative grant, kept if it stands
+};
+
+// Print a safe sequence, e.g. "Safe sequence: P1 P3 P4 P0 P2",
+// followed by one "Work after P1: 5 3 2" line per step if requested
+template <class T>
+void printSafeSequence(const vector<int>& sequence, const vector<T>& workTrace, int numResources,
+                       const OutputOptions& options, ostream& os = cout) {
+    RowWriter out(os);
+    out.text("Safe sequence:");
+    for (int pid : sequence) {
+        out.text(" P");
+        out.integer(pid);
+    }
+    out.put('\n');
+    if (!options.showWork) return;
+    for (size_t k = 0; k < sequence.size(); ++k) {
+        out.text("Work after P");
+        out.integer(sequence[k]);
+        out.text(":");
+        for (int j = 0; j < numResources; ++j) {
+            out.put(' ');
+            out.integer(workTrace[k * numResources + j]);
+        }
+        out.put('\n');
+    }
+}
+
+// Why a request or release was rejected, for the result line, e.g. "exceeds need for R2". For requests,
+// everything but "exceeds available" is permanent: the same request will never pass.
+string describeDenial(DenialReason reason, int resource) {
+    switch (reason) {
+        case DenialReason::UnknownProcess: return "unknown process";
+        case DenialReason::NegativeCount: return "negative count for R" + to_string(resource);
+        case DenialReason::ExceedsNeed: return "exceeds need for R" + to_string(resource);
+        case DenialReason::ExceedsAvailable: return "exceeds available R" + to_string(resource);
+        case DenialReason::ExceedsAllocation: return "exceeds allocation of R" + to_string(resource);
+        case DenialReason::WrongLength: return "wrong number of counts";
+        case DenialReason::None:
+        default: return "invalid request";
+    }
+}
+
+// Run one request through the resource-request algorithm (decideRequest()) and print the result.
+// Verbose mode prints the full report (new Need matrix included) for each request;
+// batch mode prints a single result line per request.
+template <class Bankers>
+void processRequest(Bankers& bankers, const string& procName, const vector<int>& request, bool systemSafe,
+                    const OutputOptions& options, LastSafeCheck<typename Bankers::Value>& last,
+                    ostream& os = cout) {
+    bool batch = options.batch;
+
+    // Before granting
+    if (!batch && systemSafe) {
+        os << "Before granting the request of " << procName << ", the system is in safe state." << "\n";
+        if (options.showSequence) {
+            if (!last.current) last.current = checkSafety(bankers, options, last.sequence, last.workTrace);
+            printSafeSequence(last.sequence, last.workTrace, bankers.resourceCount(), options, os);
+        }
+    }
+
+    // Simulate granting, printing the new Need matrix before the safety check
+    RequestResult result = decideRequest(
+        bankers, parseProcessId(procName), request, systemSafe, options.showSequence,
+        options.showWork ? &last.nextWorkTrace : nullptr, [&] {
+            if (batch) return;
+            os << "Simulating granting " << procName << "'s request." << "\n";
+            bankers.printNeedWithHeader("New Need", os);
+        });
+
+    switch (result.decision) {
+        case Decision::SystemUnsafe:
+            if (batch) os << procName << "'s request denied (current system is unsafe)." << "\n";
+            else os << "The current system is in unsafe state." << "\n";
+            break;
+        case Decision::Invalid: {
+            string why = describeDenial(result.reason, result.resource);
+            if (batch) os << procName << "'s request denied (" << why << ")." << "\n";
+            else os << procName << "'s request cannot be granted (" << why << ")." << "\n";
+            break;
+        }
+        case Decision::Granted:
+            if (batch) os << procName << "'s request granted." << "\n";
+            else os << procName << "'s request can be granted. The system will be in safe state." << "\n";
+            if (options.showSequence) {
+                last.sequence.swap(result.safeSequence);
+                last.workTrace.swap(last.nextWorkTrace);
+                last.current = true;
+                printSafeSequence(last.sequence, last.workTrace, bankers.resourceCount(), options, os);
+            }
+            break;
+        case Decision::Unsafe:
+            if (batch) os << procName << "'s request denied (system would be unsafe)." << "\n";
+            else os << procName << "'s request cannot be granted. The system will be in unsafe state." << "\n";
+            break;
+    }
+}
+
+// Release directive, e.g. "Release P1 1 0 2": return part of P1's allocation.
+// Releasing can only make the system safer, so an unsafe system is re-checked afterwards.
+// Returns whether the state changed.
+template <class Bankers>
+bool processRelease(Bankers& bankers, const string& procName, const vector<int>& release,
+                    bool& systemSafe, ostream& os = cout) {
+    int pid = parseProcessId(procName);
+    if (!bankers.release(pid, release)) {
+        int resource = -1;
+        DenialReason reason = bankers.checkRelease(pid, release, resource);
+        string why = describeDenial(reason, resource);
+        os << procName << "'s release cannot be performed (" << why << ")." << "\n";
+        return false;
+    }
+    os << procName << " released resources." << "\n";
+    if (!systemSafe) systemSafe = bankers.isSafe();
+    return true;
+}
+
+// Finish directive, e.g. "Finish P1": P1 completes and returns everything it holds.
+// Returns whether the state changed.
+template <class Bankers>
+bool processFinish(Bankers& bankers, const string& procName, bool& systemSafe, ostream& os = cout) {
+    if (!bankers.finish(parseProcessId(procName))) {
+        os << procName << " cannot finish (unknown process)." << "\n";
+        return false;
+    }
+    os << procName << " finished and released all of its resources." << "\n";
+    if (!systemSafe) systemSafe = bankers.isSafe();
+    return true;
+}
+
+// What-if admission control: every request line is evaluated on its own against the state as
+// loaded (nothing is applied), concurrently across a thread pool, and one verdict line is printed
+// per request in input order
+template <class Bankers>
+int evaluateWhatIf(const Bankers& bankers, InputScanner& in, bool systemSafe, int threads) {
+    enum Verdict : char { Granted, Invalid, Unsafe };
+    int numResources = bankers.resourceCount();
+    vector<string> names;
+    vector<int> pids;
+    vector<int> requests;          // one row of numResources per request
+
+    string_view token;
+    string error;
+    while (in.nextToken(token)) {
+        if (token == "Release" || token == "Finish") {
+            cerr << "'" << token << "' directives change the state and cannot be used with --what-if ("
+                 << in.location() << ")\n";
+            return 1;
+        }
+        names.emplace_back(token.data(), token.size());
+        pids.push_back(parseProcessId(names.back()));
+        requests.resize(requests.size() + numResources);
+        if (!readInts(in, requests.data() + requests.size() - numResources, numResources, "request", error)) {
+            cerr << error << "\n";
+            return 1;
+        }
+    }
+
+    int count = (int)names.size();
+    vector<char> verdicts(count, Unsafe);
+    vector<DenialReason> reasons(count, DenialReason::None);     // of the Invalid ones
+    vector<int> resources(count, -1);
+    if (systemSafe) {
+        ThreadPool pool(threads > 0 ? threads : (int)thread::hardware_concurrency());
+        const int kChunk = 64;     // requests per task
+        int tasks = (count + kChunk - 1) / kChunk;
+        pool.parallelFor(tasks, [&](int t) {
+            vector<int> request(numResources);
+            vector<typename Bankers::Value> scratch;
+            int last = std::min(count, (t + 1) * kChunk);
+            for (int k = t * kChunk; k < last; ++k) {
+                const int* row = requests.data() + (size_t)k * numResources;
+                request.assign(row, row + numResources);
+                if (!bankers.canRequest(pids[k], request)) {
+                    verdicts[k] = Invalid;
+                    reasons[k] = bankers.checkRequest(pids[k], request, resources[k]);
+                } else {
+                    verdicts[k] = bankers.isSafeAfter(pids[k], request, scratch) ? Granted : Unsafe;
                 }
             }
+        });
+    }
+
+    RowWriter out(cout);
+    for (int k = 0; k < count; ++k) {
+        out.text(names[k]);
+        if (!systemSafe) out.line("'s request would be denied (current system is unsafe).");
+        else if (verdicts[k] == Granted) out.line("'s request would be granted.");
+        else if (verdicts[k] == Invalid) {
+            out.text("'s request would be denied (");
+            out.text(describeDenial(reasons[k], resources[k]));
+            out.line(").");
         }
+        else out.line("'s request would be denied (system would be unsafe).");
+    }
+    return 0;
+}
 
-        // Safety algorithm: returns true if the current state is safe
-        bool isSafe() const {
-            vector<int> work = available;
-            vector<bool> finish(numProcesses, false);
+// Resource-manager daemon (--serve=PATH). The loaded state stays in memory and clients of a Unix
+// stream socket send the same request, "Release P1 1 0 2" and "Finish P1" lines the input takes,
+// one command per line, each answered by its --batch result line ("Error: ..." if malformed; blank
+// lines get no reply). A single thread owns the state and multiplexes every connection through an
+// event loop (epoll, or io_uring when built with BANKERS_IO_URING): each wakeup first reads whatever
+// the ready clients have sent, then decides their complete lines, then sends each client its
+// replies in one write, so requests arriving together are batched and a client may pipeline any
+// number of commands. SIGINT or SIGTERM shuts the server down and removes the socket.
+namespace server {
+    // Self-pipe for shutdown: the signal handler writes a byte and the event loop watches the read
+    // end, so a signal arriving at any point (even just before the loop blocks) wakes it up
+    int stopPipe[2] = { -1, -1 };
+
+    void requestStop(int) {
+        int saved = errno;
+        char byte = 1;
+        if (write(stopPipe[1], &byte, 1) < 0) {}      // full pipe: a stop is already pending
+        errno = saved;
+    }
 
-            while (true) {
-                bool progressed = false;
-                for (int i = 0; i < numProcesses; ++i) {
-                    if (finish[i]) continue;
-                    bool ok = true;
-                    for (int j = 0; j < numResources; ++j) {
-                        if (need[i][j] > work[j]) { ok = false; break; }
-                    }
-                    if (ok) {
-                        // this process can finish
-                        for (int j = 0; j < numResources; ++j) work[j] += allocation[i][j];
-                        finish[i] = true;
-                        progressed = true;
-                    }
-                }
-                if (!progressed) break;
+    const size_t kMaxLine = 1 << 20;     // longest command a client may send
+    const size_t kHighWater = 1 << 20;   // unsent reply bytes at which a client's commands stop being read
+
+    struct Client {
+        int fd;
+        string input;                    // received bytes not yet decided
+        string output;                   // replies not yet sent
+        bool hungUp = false;             // no more input; close once the replies are out
+    };
+
+    // Listen on a Unix stream socket at path. A socket file left behind by a server that is no
+    // longer running is replaced; one still accepting connections is an error.
+    int listenOn(const string& path, string& error) {
+        sockaddr_un address;
+        memset(&address, 0, sizeof address);
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof address.sun_path) {
+            error = "path too long";
+            return -1;
+        }
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        struct stat st;
+        if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            bool live = probe >= 0 && connect(probe, (const sockaddr*)&address, sizeof address) == 0;
+            if (probe >= 0) close(probe);
+            if (live) {
+                error = "another server is listening there";
+                return -1;
             }
+            unlink(path.c_str());
+        }
 
-            for (int i = 0; i < numProcesses; ++i) if (!finish[i]) return false;
-            return true;
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0 || bind(fd, (const sockaddr*)&address, sizeof address) < 0 || listen(fd, SOMAXCONN) < 0) {
+            error = strerror(errno);
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // Decide one command line, writing its reply to out
+    template <class Bankers>
+    void handleLine(Bankers& bankers, string_view line, bool& systemSafe, const OutputOptions& output,
+                    vector<int>& values, string& procName, LastSafeCheck<typename Bankers::Value>& last,
+                    ostream& out) {
+        InputScanner in;
+        in.openBuffer(line.data(), line.size());
+        string_view token;
+        if (!in.nextToken(token)) return;
+        bool isFinish = token == "Finish";
+        bool isRelease = token == "Release";
+        if ((isFinish || isRelease) && !in.nextToken(token)) {
+            out << "Error: expected process after '" << (isFinish ? "Finish" : "Release") << "'\n";
+            return;
+        }
+        procName.assign(token.data(), token.size());
+        if (!isFinish) {
+            for (int& value : values) {
+                if (!in.nextInt(value)) {
+                    out << "Error: expected " << values.size() << " integers after '" << procName << "'\n";
+                    return;
+                }
+            }
+        }
+        if (in.nextToken(token)) {
+            out << "Error: unexpected '" << token << "' after the command\n";
+            return;
         }
 
-        // Check if a request can be considered: req <= need and req <= available
-        bool canRequest(int pid, const vector<int>& req) const {
-            if (pid < 0 || pid >= numProcesses) return false;
+        if (isFinish) {
+            if (processFinish(bankers, procName, systemSafe, out)) last.current = false;
+        } else if (isRelease) {
+            if (processRelease(bankers, procName, values, systemSafe, out)) last.current = false;
+        } else {
+            processRequest(bankers, procName, values, systemSafe, output, last, out);
+        }
+        reportDisagreements(bankers);
+    }
 
-            for (int j = 0; j < numResources; ++j) {
-                if (req[j] > need[pid][j]) return false;
-                if (req[j] > available[j]) return false;
+    // Read everything the client has sent so far; false on a read error
+    bool receive(Client& client) {
+        char chunk[1 << 16];
+        while (true) {
+            ssize_t n = read(client.fd, chunk, sizeof chunk);
+            if (n > 0) {
+                client.input.append(chunk, (size_t)n);
+                continue;
             }
+            if (n == 0) client.hungUp = true;
+            else if (errno == EINTR) continue;
+            else if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
             return true;
         }
+    }
 
-        // Apply the request (assumes it's valid). Modifies allocation, available, need.
-        void applyRequest(int pid, const vector<int>& req) {
-            if (pid < 0 || pid >= numProcesses) return;
-            for (int j = 0; j < numResources; ++j) {
-                allocation[pid][j] += req[j];
-                available[j] -= req[j];
-                need[pid][j] -= req[j];
-                if (need[pid][j] < 0) need[pid][j] = 0;
-            }
+    // Send as much of the client's pending replies as the socket takes; false on a write error
+    bool flush(Client& client) {
+        size_t sent = 0;
+        while (sent < client.output.size()) {
+            ssize_t n = send(client.fd, client.output.data() + sent, client.output.size() - sent, MSG_NOSIGNAL);
+            if (n > 0) sent += (size_t)n;
+            else if (n < 0 && errno == EINTR) continue;
+            else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            else return false;
         }
+        client.output.erase(0, sent);
+        return true;
+    }
+
+    // What a wait() reported for one descriptor. Errors and hangups count as readable: the next
+    // read() reports them.
+    struct Ready {
+        int fd;
+        bool readable;
+        bool writable;
+    };
+
+    // Level-triggered epoll. watch() only issues an epoll_ctl() when the interest set changes.
+    class EpollLoop {
+        private:
+            int epollFd = -1;
+            vector<uint32_t> interest;       // registered events per fd (0: not registered)
+            vector<epoll_event> events;
+
+        public:
+            EpollLoop() {}
+            EpollLoop(const EpollLoop&) = delete;
+            EpollLoop& operator=(const EpollLoop&) = delete;
+            ~EpollLoop() {
+                if (epollFd >= 0) close(epollFd);
+            }
+
+            bool open(string& error) {
+                epollFd = epoll_create1(EPOLL_CLOEXEC);
+                if (epollFd < 0) { error = strerror(errno); return false; }
+                events.resize(256);
+                return true;
+            }
 
-        // Print just the need matrix with a header (used for 'New Need')
-        void printNeedWithHeader(const string& header) const {
-            cout << header << '\n';
-            for (int i = 0; i < numProcesses; ++i) {
-                for (int j = 0; j < numResources; ++j) {
-                    if (j) cout << ' ';
-                    cout << need[i][j];
+            // Wait for fd to become readable and/or writable. Called for a new descriptor and again
+            // after each of its events has been handled.
+            bool watch(int fd, bool read, bool write) {
+                uint32_t mask = (read ? (uint32_t)EPOLLIN : 0) | (write ? (uint32_t)EPOLLOUT : 0);
+                if ((size_t)fd >= interest.size()) interest.resize((size_t)fd + 1, 0);
+                if (interest[fd] == mask) return true;
+                epoll_event event;
+                event.events = mask;
+                event.data.fd = fd;
+                if (epoll_ctl(epollFd, interest[fd] ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) < 0) return false;
+                interest[fd] = mask;
+                return true;
+            }
+
+            // Stop watching fd; call before closing it
+            void forget(int fd) {
+                if ((size_t)fd < interest.size() && interest[fd]) {
+                    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+                    interest[fd] = 0;
                 }
-                cout << '\n';
             }
-        }
 
-        // Print current state (for verification)
-        void printState() const {
-            cout << "Resources: " << numResources << ", Processes: " << numProcesses << "\n";
-            cout << "Available\n";
-            for (int j = 0; j < numResources; ++j) {
-                if (j) cout << ' ';
-                cout << available[j];
+            // Block until something is ready; an interrupted wait returns true with nothing ready
+            bool wait(vector<Ready>& ready) {
+                ready.clear();
+                int n = epoll_wait(epollFd, events.data(), (int)events.size(), -1);
+                if (n < 0) return errno == EINTR;
+                for (int k = 0; k < n; ++k) {
+                    uint32_t e = events[k].events;
+                    ready.push_back(Ready{ events[k].data.fd, (e & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0,
+                                           (e & EPOLLOUT) != 0 });
+                }
+                if (n == (int)events.size()) events.resize(events.size() * 2);
+                return true;
+            }
+    };
+
+#ifdef BANKERS_IO_URING
+    // io_uring through the raw system calls (no liburing): every watch() queues a one-shot
+    // IORING_OP_POLL_ADD, and wait() submits everything queued and waits for completions in a
+    // single io_uring_enter(). Completions carry the fd and a per-fd generation, so one arriving
+    // after forget() (or for a reused fd number) is ignored.
+    class UringLoop {
+        private:
+            static const uint64_t kRemoveTag = ~0ULL;     // user_data of POLL_REMOVE requests
+
+            int ringFd = -1;
+            void* sqRing = MAP_FAILED;
+            void* cqRing = MAP_FAILED;
+            void* sqeArea = MAP_FAILED;
+            size_t sqRingSize = 0, cqRingSize = 0, sqeAreaSize = 0;
+            unsigned *sqHead = nullptr, *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr;
+            unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+            unsigned sqEntries = 0;
+            io_uring_sqe* sqes = nullptr;
+            io_uring_cqe* cqes = nullptr;
+            unsigned queued = 0;                 // SQEs not yet submitted
+            vector<uint32_t> generation;         // per fd, bumped by forget()
+            vector<char> armed;                  // per fd, a poll request is outstanding
+
+            static uint64_t tag(int fd, uint32_t gen) { return ((uint64_t)gen << 32) | (uint32_t)fd; }
+
+            int enter(unsigned submit, unsigned waitFor, unsigned flags) {
+                return (int)syscall(__NR_io_uring_enter, ringFd, submit, waitFor, flags, nullptr, 0);
+            }
+
+            // Next free submission entry, submitting the queue first if it is full
+            io_uring_sqe* nextSqe() {
+                unsigned tail = *sqTail;
+                if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == sqEntries) {
+                    if (enter(queued, 0, 0) < 0) return nullptr;
+                    queued = 0;
+                }
+                unsigned index = tail & *sqMask;
+                io_uring_sqe* sqe = &sqes[index];
+                memset(sqe, 0, sizeof *sqe);
+                sqArray[index] = index;
+                __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+                ++queued;
+                return sqe;
             }
-            cout << "\n";
 
-            cout << "Max\n";
-            for (int i = 0; i < numProcesses; ++i) {
-                for (int j = 0; j < numResources; ++j) {
-                    if (j) cout << ' ';
-                    cout << max[i][j];
+            void track(int fd) {
+                if ((size_t)fd >= generation.size()) {
+                    generation.resize((size_t)fd + 1, 0);
+                    armed.resize((size_t)fd + 1, 0);
                 }
-                cout << '\n';
             }
 
-            cout << "Allocation\n";
-            for (int i = 0; i < numProcesses; ++i) {
-                for (int j = 0; j < numResources; ++j) {
-                    if (j) cout << ' ';
-                    cout << allocation[i][j];
+        public:
+            UringLoop() {}
+            UringLoop(const UringLoop&) = delete;
+            UringLoop& operator=(const UringLoop&) = delete;
+            ~UringLoop() {
+                if (sqeArea != MAP_FAILED) munmap(sqeArea, sqeAreaSize);
+                if (cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+                if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+                if (ringFd >= 0) close(ringFd);
+            }
+
+            bool open(string& error) {
+                io_uring_params params;
+                memset(&params, 0, sizeof params);
+                ringFd = (int)syscall(__NR_io_uring_setup, 256, &params);
+                if (ringFd < 0) { error = string("io_uring_setup: ") + strerror(errno); return false; }
+
+                sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if (singleMap) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+                sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                              ringFd, IORING_OFF_SQ_RING);
+                if (sqRing == MAP_FAILED) { error = string("mmap: ") + strerror(errno); return false; }
+                cqRing = singleMap ? sqRing
+                                   : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                          ringFd, IORING_OFF_CQ_RING);
+                if (cqRing == MAP_FAILED) { error = string("mmap: ") + strerror(errno); return false; }
+                sqeAreaSize = params.sq_entries * sizeof(io_uring_sqe);
+                sqeArea = mmap(nullptr, sqeAreaSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                               ringFd, IORING_OFF_SQES);
+                if (sqeArea == MAP_FAILED) { error = string("mmap: ") + strerror(errno); return false; }
+
+                char* sq = (char*)sqRing;
+                char* cq = (char*)cqRing;
+                sqHead = (unsigned*)(sq + params.sq_off.head);
+                sqTail = (unsigned*)(sq + params.sq_off.tail);
+                sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+                sqArray = (unsigned*)(sq + params.sq_off.array);
+                sqEntries = params.sq_entries;
+                cqHead = (unsigned*)(cq + params.cq_off.head);
+                cqTail = (unsigned*)(cq + params.cq_off.tail);
+                cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+                sqes = (io_uring_sqe*)sqeArea;
+                cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+                return true;
+            }
+
+            bool watch(int fd, bool read, bool write) {
+                track(fd);
+                if (armed[fd]) return true;
+                io_uring_sqe* sqe = nextSqe();
+                if (!sqe) return false;
+                sqe->opcode = IORING_OP_POLL_ADD;
+                sqe->fd = fd;
+                sqe->poll32_events = (read ? POLLIN : 0) | (write ? POLLOUT : 0);
+                sqe->user_data = tag(fd, generation[fd]);
+                armed[fd] = 1;
+                return true;
+            }
+
+            void forget(int fd) {
+                track(fd);
+                if (armed[fd]) {
+                    io_uring_sqe* sqe = nextSqe();
+                    if (sqe) {
+                        sqe->opcode = IORING_OP_POLL_REMOVE;
+                        sqe->addr = tag(fd, generation[fd]);
+                        sqe->user_data = kRemoveTag;
+                    }
+                    armed[fd] = 0;
                 }
-                cout << '\n';
+                ++generation[fd];
             }
 
-            cout << "Need\n";
-            for (int i = 0; i < numProcesses; ++i) {
-                for (int j = 0; j < numResources; ++j) {
-                    if (j) cout << ' ';
-                    cout << need[i][j];
+            bool wait(vector<Ready>& ready) {
+                ready.clear();
+                if (enter(queued, 1, IORING_ENTER_GETEVENTS) < 0) return errno == EINTR;
+                queued = 0;
+                unsigned head = *cqHead;
+                unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+                for (; head != tail; ++head) {
+                    const io_uring_cqe& cqe = cqes[head & *cqMask];
+                    if (cqe.user_data == kRemoveTag) continue;
+                    int fd = (int)(uint32_t)cqe.user_data;
+                    if ((size_t)fd >= generation.size() || generation[fd] != (uint32_t)(cqe.user_data >> 32)) continue;
+                    armed[fd] = 0;
+                    int events = cqe.res < 0 ? POLLERR : cqe.res;
+                    ready.push_back(Ready{ fd, (events & (POLLIN | POLLHUP | POLLERR)) != 0, (events & POLLOUT) != 0 });
                 }
-                cout << '\n';
+                __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+                return true;
             }
+    };
+#endif
+
+    // Serve on the given event loop until stopFd becomes readable (SIGINT/SIGTERM)
+    template <class Loop, class Bankers>
+    int serveWith(Loop& loop, int listener, int stopFd, Bankers& bankers, bool& systemSafe,
+                  const OutputOptions& output) {
+        unordered_map<int, Client> clients;
+        vector<Ready> ready;
+        vector<int> batch;                   // clients with events this wakeup
+        vector<int> values(bankers.resourceCount());
+        string procName;
+        LastSafeCheck<typename Bankers::Value> last;
+        ostringstream reply;
+        if (!loop.watch(listener, true, false)) {
+            cerr << "Cannot watch the listening socket: " << strerror(errno) << "\n";
+            return 1;
+        }
+        if (!loop.watch(stopFd, true, false)) {
+            cerr << "Cannot watch the shutdown pipe: " << strerror(errno) << "\n";
+            return 1;
         }
-};
 
-int main(){
-    // Parse input from stdin to populate the Banker's Algorithm data structures
-    string token;
-    int numResources = 0;
-    int numProcesses = 0;
+        bool stopping = false;
+        while (!stopping) {
+            if (!loop.wait(ready)) {
+                cerr << "Event wait failed: " << strerror(errno) << "\n";
+                return 1;
+            }
 
-    if (!(cin >> token)) return 0;
-    if (token == "R" || token == "r") {
-        cin >> numResources;
-    } else {
-        cerr << "Expected 'R' at start\n";
-        return 1;
-    }
+            // Read from every ready client before deciding anything, so the batch is as large as possible
+            batch.clear();
+            for (const Ready& event : ready) {
+                if (event.fd == stopFd) {
+                    stopping = true;         // after this wakeup's clients are served
+                    continue;
+                }
+                if (event.fd == listener) {
+                    int fd;
+                    while ((fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                        if (loop.watch(fd, true, false)) clients.emplace(fd, Client{ fd, string(), string(), false });
+                        else close(fd);
+                    }
+                    loop.watch(listener, true, false);
+                    continue;
+                }
+                auto found = clients.find(event.fd);
+                if (found == clients.end()) continue;
+                Client& client = found->second;
+                if (event.readable && !client.hungUp && !receive(client)) {
+                    loop.forget(event.fd);
+                    close(event.fd);
+                    clients.erase(found);
+                    continue;
+                }
+                batch.push_back(event.fd);
+            }
 
-    if (!(cin >> token)) { cerr << "Expected 'P' after resources\n"; return 1; }
-    if (token == "P") {
-        cin >> numProcesses;
-    } else {
-        cerr << "Expected 'P' token\n";
-        return 1;
-    }
+            // Decide each client's complete lines (and a last unterminated one once it hung up), then
+            // send its replies in one write. A client that does not read its replies gets no more
+            // than kHighWater of them queued: deciding stops there, and so does reading its socket,
+            // until enough of them have been sent.
+            for (int fd : batch) {
+                Client& client = clients[fd];
+                bool ok, pending;
+                do {
+                    size_t start = 0, newline;
+                    while (client.output.size() + (size_t)reply.tellp() < kHighWater &&
+                           (newline = client.input.find('\n', start)) != string::npos) {
+                        handleLine(bankers, string_view(client.input).substr(start, newline - start), systemSafe,
+                                   output, values, procName, last, reply);
+                        start = newline + 1;
+                    }
+                    client.input.erase(0, start);
+                    pending = client.input.find('\n') != string::npos;
+                    if (!pending && client.hungUp && !client.input.empty()) {
+                        handleLine(bankers, client.input, systemSafe, output, values, procName, last, reply);
+                        client.input.clear();
+                    } else if (!pending && client.input.size() > kMaxLine) {
+                        reply << "Error: line too long\n";
+                        client.input.clear();
+                        client.hungUp = true;
+                    }
+                    if (reply.tellp() > 0) {
+                        client.output += reply.str();
+                        reply.str("");
+                    }
+                    ok = flush(client);
+                    // lines held back for the high-water mark, now that everything went out
+                } while (ok && pending && client.output.empty());
+
+                bool reading = !client.hungUp && client.output.size() < kHighWater;
+                if (!ok || (client.hungUp && client.output.empty()) ||
+                    !loop.watch(fd, reading, !client.output.empty())) {
+                    loop.forget(fd);
+                    close(fd);
+                    clients.erase(fd);
+                }
+            }
+        }
 
-    // Create the Banker's Algorithm instance with the parsed number of processes and resources
-    BankersAlgorithm bankers(numProcesses, numResources);
+        for (const auto& entry : clients) {
+            loop.forget(entry.first);
+            close(entry.first);
+        }
+        return 0;
+    }
 
-    // Available
-    if (!(cin >> token)) { cerr << "Unexpected EOF reading Available\n"; return 1; }
-    if (token != "Available") {
-        cerr << "Expected 'Available' but found '" << token << "'\n";
-        return 1;
+    template <class Bankers>
+    int run(Bankers& bankers, const string& path, const string& loopName, bool systemSafe,
+            const OutputOptions& output) {
+        string error;
+        int listener = listenOn(path, error);
+        if (listener < 0) {
+            cerr << "Cannot listen on '" << path << "': " << error << "\n";
+            return 1;
+        }
+        if (pipe2(stopPipe, O_NONBLOCK | O_CLOEXEC) < 0) {
+            cerr << "Cannot create the shutdown pipe: " << strerror(errno) << "\n";
+            close(listener);
+            unlink(path.c_str());
+            return 1;
+        }
+        signal(SIGINT, requestStop);
+        signal(SIGTERM, requestStop);
+
+        int status = 1;
+        if (loopName == "io_uring") {
+#ifdef BANKERS_IO_URING
+            UringLoop loop;
+            if (loop.open(error)) status = serveWith(loop, listener, stopPipe[0], bankers, systemSafe, output);
+            else cerr << "Cannot set up io_uring: " << error << "\n";
+#endif
+        } else {
+            EpollLoop loop;
+            if (loop.open(error)) status = serveWith(loop, listener, stopPipe[0], bankers, systemSafe, output);
+            else cerr << "Cannot set up epoll: " << error << "\n";
+        }
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        close(stopPipe[0]);
+        close(stopPipe[1]);
+        close(listener);
+        unlink(path.c_str());
+        return status;
     }
-    vector<int> available(numResources);
-    for (int j = 0; j < numResources; ++j) cin >> available[j];
-    bankers.setAvailable(available);
-
-    // Max
-    if (!(cin >> token)) { cerr << "Unexpected EOF reading Max\n"; return 1; }
-    if (token != "Max") { cerr << "Expected 'Max' but found '" << token << "'\n"; return 1; }
-    for (int i = 0; i < numProcesses; ++i) {
-        vector<int> row(numResources);
-        for (int j = 0; j < numResources; ++j) cin >> row[j];
-        bankers.setMaxRow(i, row);
+}
+
+// Configure the safety engine, then process the request, "Release P1 1 0 2" and "Finish P1" lines
+// that follow the state, in order against the evolving state (or all against the loaded state
+// with --what-if). Granted requests stay applied; a request that would leave the system unsafe is
+// rolled back. Nothing is ever granted from an unsafe state, so safety is checked once up front and
+// again only when a release or finish might have made an unsafe system safe.
+template <class Bankers>
+int processInput(Bankers& bankers, InputScanner& in, const EngineOptions& engine, const OutputOptions& output,
+                 const RunMode& mode) {
+    int threads = engine.threads > 0 ? engine.threads : (int)thread::hardware_concurrency();
+    bankers.setEngine(engine.engine);
+    bankers.setIncremental(engine.incremental);
+    if (engine.engine == SafetyEngine::Parallel || engine.engine == SafetyEngine::CrossCheck) {
+        bankers.setThreads(threads);
     }
 
-    // Allocation
-    if (!(cin >> token)) { cerr << "Unexpected EOF reading Allocation\n"; return 1; }
-    if (token != "Allocation") { cerr << "Expected 'Allocation' but found '" << token << "'\n"; return 1; }
-    for (int i = 0; i < numProcesses; ++i) {
-        vector<int> row(numResources);
-        for (int j = 0; j < numResources; ++j) cin >> row[j];
-        bankers.setAllocationRow(i, row);
+    LastSafeCheck<typename Bankers::Value> last;
+    bool systemSafe = checkSafety(bankers, output, last.sequence, last.workTrace);
+    last.current = systemSafe;
+    reportDisagreements(bankers);
+    if (mode.whatIf) return evaluateWhatIf(bankers, in, systemSafe, threads);
+    if (!mode.servePath.empty()) {
+        string_view extra;
+        if (in.nextToken(extra)) {
+            cerr << "Requests on stdin cannot be used with --serve ('" << extra << "' at " << in.location() << ")\n";
+            return 1;
+        }
+        return server::run(bankers, mode.servePath, mode.serveLoop, systemSafe, output);
     }
 
-    // Optional request line: e.g. "P1 1 0 2"
     string procName;
-    vector<int> request(numResources, 0);
-    if (cin >> procName) {
-        int pid = -1;
-        if (!procName.empty() && (procName[0] == 'P' || procName[0] == 'p')) {
-            try {
-                pid = stoi(procName.substr(1));
-            } catch (...) { pid = -1; }
-        }
-        for (int j = 0; j < numResources; ++j) cin >> request[j];
+    string_view token;
+    string error;
+    vector<int> request(bankers.resourceCount(), 0);
+    while (in.nextToken(token)) {
+        if (token == "Finish") {
+            if (!in.nextToken(token)) { cerr << "Expected process after 'Finish'\n"; return 1; }
+            procName.assign(token.data(), token.size());
+            if (processFinish(bankers, procName, systemSafe)) last.current = false;
+            reportDisagreements(bankers);
+            continue;
+        }
+        bool isRelease = token == "Release";
+        if (isRelease && !in.nextToken(token)) { cerr << "Expected process after 'Release'\n"; return 1; }
+        procName.assign(token.data(), token.size());
+        if (!readInts(in, request.data(), request.size(), isRelease ? "release" : "request", error)) {
+            cerr << error << "\n";
+            return 1;
+        }
+        if (isRelease) {
+            if (processRelease(bankers, procName, request, systemSafe)) last.current = false;
+        } else {
+            processRequest(bankers, procName, request, systemSafe, output, last);
+        }
+        reportDisagreements(bankers);
     }
+    return 0;
+}
 
-    // Compute need for the current state
-    bankers.computeNeed();
+// How the parsed state is stored while the input is processed
+struct StorageOptions {
+    ElementType elementType = ElementType::Int32;
+    bool fixedWidth = true;     // specialize for R = 3, 4, 8 and 16
+    bool sparse = false;        // CSR rows (SparseBankersAlgorithm)
+};
 
-    // If we have a request, run checks and simulate granting
-    if (!procName.empty()) {
-        int pid = -1;
-        if (!procName.empty() && (procName[0] == 'P' || procName[0] == 'p')) {
-            try { pid = stoi(procName.substr(1)); } catch(...) { pid = -1; }
-        }
+template <int R, class T>
+int processInputAs(BankersAlgorithm&& bankers, InputScanner& in, const EngineOptions& engine,
+                   const OutputOptions& output, const RunMode& mode) {
+    BasicBankersAlgorithm<R, T> typed = BasicBankersAlgorithm<R, T>::adopt(move(bankers));
+    return processInput(typed, in, engine, output, mode);
+}
 
-        // Check if the current state is safe before granting the request
-        if(bankers.isSafe()){
-            // Before granting
-            cout << "Before granting the request of " << procName << ", the system is in safe state." << "\n";
+// Run processInput() on the state converted to T: in CSR rows if storage.sparse is set, otherwise
+// dense and specialized for its resource count if it is 3, 4, 8 or 16 and storage.fixedWidth is
+// set. int64_t states (sums past INT_MAX) are rare enough to always take the general code.
+template <class T>
+int processInputTyped(BankersAlgorithm&& bankers, InputScanner& in, const EngineOptions& engine,
+                      const OutputOptions& output, const RunMode& mode, const StorageOptions& storage) {
+    if (storage.sparse) {
+        SparseBankersAlgorithm<T> sparse = SparseBankersAlgorithm<T>::fromDense(move(bankers));
+        return processInput(sparse, in, engine, output, mode);
+    }
+    if constexpr (!is_same<T, int64_t>::value) {
+        switch (storage.fixedWidth ? bankers.resourceCount() : 0) {
+            case 3: return processInputAs<3, T>(move(bankers), in, engine, output, mode);
+            case 4: return processInputAs<4, T>(move(bankers), in, engine, output, mode);
+            case 8: return processInputAs<8, T>(move(bankers), in, engine, output, mode);
+            case 16: return processInputAs<16, T>(move(bankers), in, engine, output, mode);
+            default: break;
+        }
+    }
+    return processInputAs<0, T>(move(bankers), in, engine, output, mode);
+}
 
+int processInputDispatched(BankersAlgorithm& bankers, InputScanner& in, const EngineOptions& engine,
+                           const OutputOptions& output, const RunMode& mode, const StorageOptions& storage) {
+    switch (storage.elementType) {
+        case ElementType::UInt8:
+            return processInputTyped<uint8_t>(move(bankers), in, engine, output, mode, storage);
+        case ElementType::UInt16:
+            return processInputTyped<uint16_t>(move(bankers), in, engine, output, mode, storage);
+        case ElementType::Int64:
+            return processInputTyped<int64_t>(move(bankers), in, engine, output, mode, storage);
+        case ElementType::Int32:
+        default:
+            return processInputTyped<int>(move(bankers), in, engine, output, mode, storage);
+    }
+}
 
-            // Check request validity
-            if (!bankers.canRequest(pid, request)) {
-                cout << procName << "'s request cannot be granted (exceeds need or available)." << "\n";
-                return 0;
+int main(int argc, char* argv[]){
+    // Command line options: --engine=sweep|worklist|parallel|check selects the safety algorithm,
+    // --threads=N sets the parallel engine's thread count (default: all hardware threads),
+    // --simd=auto|scalar|avx2|avx512 overrides the vector kernel dispatch,
+    // --batch prints one result line per request instead of the full report,
+    // --incremental reuses the last safe sequence between safety checks,
+    // --what-if evaluates every request independently against the loaded state, in parallel,
+    // --serve=PATH keeps the state loaded and answers requests from clients of a Unix socket at PATH,
+    // --serve-loop=epoll|io_uring picks the server's event loop (io_uring needs BANKERS_IO_URING),
+    // --fixed-width=off keeps the runtime-width code for R = 3, 4, 8, 16 instead of the specializations,
+    // --element-type=auto|uint8|uint16|int32|int64 picks the integer type of the state (auto: narrowest that fits),
+    // --storage=auto|dense|sparse picks dense or CSR rows (auto: CSR when at most 5% of the cells are nonzero),
+    // --show-sequence prints the safe sequence after each "safe state" line,
+    // --show-work also prints the Work vector after each process in it finishes,
+    // --save-snapshot=FILE writes the parsed state as a binary snapshot,
+    // --load-snapshot=FILE takes the state from a snapshot; stdin then holds only requests
+    EngineOptions engine;
+    OutputOptions output;
+    RunMode mode;
+    StorageOptions storage;
+    string elementTypeName = "auto";
+    string storageName = "auto";
+    string saveSnapshotPath, loadSnapshotPath;
+    for (int a = 1; a < argc; ++a) {
+        string arg = argv[a];
+        if (arg == "--engine=sweep") engine.engine = SafetyEngine::Sweep;
+        else if (arg == "--engine=worklist") engine.engine = SafetyEngine::Worklist;
+        else if (arg == "--engine=parallel") engine.engine = SafetyEngine::Parallel;
+        else if (arg == "--engine=check") engine.engine = SafetyEngine::CrossCheck;
+        else if (arg.compare(0, 10, "--threads=") == 0) {
+            engine.threads = atoi(arg.c_str() + 10);
+            if (engine.threads < 1) { cerr << "Invalid thread count '" << arg.substr(10) << "'\n"; return 1; }
+        }
+        else if (arg == "--batch") output.batch = true;
+        else if (arg == "--show-sequence") output.showSequence = true;
+        else if (arg == "--show-work") output.showSequence = output.showWork = true;
+        else if (arg == "--incremental") engine.incremental = true;
+        else if (arg == "--what-if") mode.whatIf = true;
+        else if (arg.compare(0, 8, "--serve=") == 0) mode.servePath = arg.substr(8);
+        else if (arg == "--serve-loop=epoll" || arg == "--serve-loop=io_uring") mode.serveLoop = arg.substr(13);
+        else if (arg == "--fixed-width=auto") storage.fixedWidth = true;
+        else if (arg == "--fixed-width=off") storage.fixedWidth = false;
+        else if (arg == "--storage=auto" || arg == "--storage=dense" || arg == "--storage=sparse") {
+            storageName = arg.substr(10);
+        }
+        else if (arg.compare(0, 15, "--element-type=") == 0) elementTypeName = arg.substr(15);
+        else if (arg.compare(0, 7, "--simd=") == 0) {
+            if (!kernels::force(arg.substr(7))) {
+                cerr << "SIMD kernels '" << arg.substr(7) << "' are not available on this CPU\n";
+                return 1;
             }
+        }
+        else if (arg.compare(0, 16, "--save-snapshot=") == 0) saveSnapshotPath = arg.substr(16);
+        else if (arg.compare(0, 16, "--load-snapshot=") == 0) loadSnapshotPath = arg.substr(16);
+        else { cerr << "Unknown option '" << arg << "'\n"; return 1; }
+    }
 
-            // Simulate granting
-            cout << "Simulating granting " << procName << "'s request." << "\n";
-            bankers.applyRequest(pid, request);
+    if (!mode.servePath.empty()) {
+        if (mode.whatIf || output.showSequence) {
+            cerr << "--serve cannot be combined with --what-if, --show-sequence or --show-work\n";
+            return 1;
+        }
+        output.batch = true;
+    }
+#ifndef BANKERS_IO_URING
+    if (mode.serveLoop == "io_uring") {
+        cerr << "io_uring support is not compiled in (build with -DBANKERS_IO_URING)\n";
+        return 1;
+    }
+#endif
 
-            // Print new Need matrix
-            bankers.printNeedWithHeader("New Need");
+    ios::sync_with_stdio(false);
 
-            // Check safety after granting
-            if (bankers.isSafe()) {
-                cout << procName << "'s request can be granted. The system will be in safe state." << "\n";
-            } else {
-                cout << procName << "'s request cannot be granted. The system will be in unsafe state." << "\n";
-            }
+    InputScanner in;
+    if (!in.open(0)) { cerr << "Cannot read input\n"; return 1; }
 
+    // Populate the Banker's Algorithm data structures from a snapshot or from the text on stdin
+    BankersAlgorithm bankers(0, 0);
+    if (!loadSnapshotPath.empty()) {
+        string error;
+        if (!BankersAlgorithm::loadSnapshot(loadSnapshotPath, bankers, error)) {
+            cerr << "Cannot load snapshot '" << loadSnapshotPath << "': " << error << "\n";
+            return 1;
         }
-        else {
-            cout << "The current system is in unsafe state." << "\n";
+    } else {
+        string error;
+        if (!parseState(in, bankers, error)) {
+            cerr << error << "\n";
+            return 1;
         }
     }
 
-    return 0;
+    if (!saveSnapshotPath.empty()) {
+        string error;
+        if (!bankers.saveSnapshot(saveSnapshotPath, error)) {
+            cerr << "Cannot save snapshot '" << saveSnapshotPath << "': " << error << "\n";
+            return 1;
+        }
+    }
+
+    // Narrowest element type that fits, or the one asked for if it is at least that wide
+    ElementType elementType = elementTypeFor(bankers);
+    if (elementTypeName != "auto") {
+        const char* names[] = { "uint8", "uint16", "int32", "int64" };
+        int chosen = (int)(find(names, names + 4, elementTypeName) - names);
+        if (chosen == 4) { cerr << "Unknown element type '" << elementTypeName << "'\n"; return 1; }
+        if (chosen < (int)elementType) {
+            cerr << "The state does not fit in " << elementTypeName << "; it needs at least "
+                 << names[(int)elementType] << "\n";
+            return 1;
+        }
+        elementType = (ElementType)chosen;
+    }
+    storage.elementType = elementType;
+
+    // CSR rows for mostly-zero states; they hold nonnegative counts only
+    const double kSparseDensity = 0.05;
+    if (storageName == "sparse") {
+        if (hasNegativeCounts(bankers)) {
+            cerr << "Sparse storage needs nonnegative Available, Max and Allocation counts\n";
+            return 1;
+        }
+        storage.sparse = true;
+    } else if (storageName == "auto") {
+        storage.sparse = nonzeroDensity(bankers) <= kSparseDensity && !hasNegativeCounts(bankers);
+    }
+    return processInputDispatched(bankers, in, engine, output, mode, storage);
 }